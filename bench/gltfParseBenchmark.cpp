@@ -0,0 +1,114 @@
+//Compares the on-demand glTF json scanner of the import pre-checks with a full QJsonDocument parse of the same file.
+//Both sides extract the mesh names and accessor counts the import summary shows.
+//Usage: gltfParseBenchmark [max meshes, default 10000] [work directory]
+#include "syntheticAssets.h"
+#include "gltfScanner.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    constexpr double MIN_MEASURE_SECONDS = 0.25;
+
+    //Best time of repeated runs.
+    double measure(const std::function<void()>& run) {
+        double best = 1e30;
+        double total = 0.0;
+        int repetitions = 0;
+        do {
+            const auto start = std::chrono::steady_clock::now();
+            run();
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = std::min(best, seconds);
+            total += seconds;
+            ++repetitions;
+        } while (total < MIN_MEASURE_SECONDS && repetitions < 1000);
+        return best;
+    }
+
+    std::string readFile(const std::filesystem::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        std::ostringstream content;
+        content << in.rdbuf();
+        if (!in)
+            throw std::runtime_error("Failed to read " + path.generic_string());
+        return content.str();
+    }
+
+    volatile size_t vertexSink = 0;
+
+    //Mesh count, the vertex counts are summed up like the import summary does.
+    size_t qjsonMeshCount(const std::string& json) {
+        const auto document = QJsonDocument::fromJson(QByteArray::fromRawData(json.data(), static_cast<int>(json.size())));
+        const auto root = document.object();
+        size_t vertices = 0;
+        const auto accessors = root.value("accessors").toArray();
+        for (const auto& mesh : root.value("meshes").toArray()) {
+            for (const auto& primitive : mesh.toObject().value("primitives").toArray()) {
+                const auto position = primitive.toObject().value("attributes").toObject().value("POSITION").toInt(-1);
+                if (position >= 0 && position < accessors.size())
+                    vertices += accessors[position].toObject().value("count").toInt();
+            }
+        }
+        vertexSink = vertices;
+        return root.value("meshes").toArray().size();
+    }
+
+    void benchmarkParse(int meshes, const std::filesystem::path& directory) {
+        SyntheticGltfOptions options;
+        options.submeshes = meshes;
+        options.triangles = static_cast<size_t>(meshes) * 2;
+        options.skinned = true;
+        options.texture_size = 0;
+        const auto asset = writeSyntheticGltf(directory, "parse", options);
+        const auto json = readFile(asset.gltf_path);
+
+        size_t scanned_meshes = 0;
+        const double scan_seconds = measure([&]() {
+            scanned_meshes = scanGltfJson(json).meshes.size();
+        });
+        size_t parsed_meshes = 0;
+        const double qjson_seconds = measure([&]() {
+            parsed_meshes = qjsonMeshCount(json);
+        });
+        if (scanned_meshes != static_cast<size_t>(meshes) || parsed_meshes != static_cast<size_t>(meshes))
+            throw std::runtime_error("Mesh count mismatch for " + std::to_string(meshes) + " meshes");
+
+        const double mib = json.size() / (1024.0 * 1024.0);
+        printf("%10d %10.2f %12.3f %12.1f %12.3f %12.1f %9.1fx\n", meshes, mib,
+            scan_seconds * 1e3, mib / scan_seconds, qjson_seconds * 1e3, mib / qjson_seconds, qjson_seconds / scan_seconds);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const int max_meshes = argc > 1 ? std::atoi(argv[1]) : 10000;
+    const auto work_directory = argc > 2 ? std::filesystem::path(argv[2]) :
+        std::filesystem::temp_directory_path() / "glacierPrimIOParseBench";
+
+    int result = EXIT_SUCCESS;
+    try {
+        std::filesystem::create_directories(work_directory);
+        printf("%10s %10s %12s %12s %12s %12s %10s\n", "Meshes", "MiB json", "scan ms", "scan MiB/s", "QJson ms", "QJson MiB/s", "Speedup");
+        for (int meshes = 10; meshes <= max_meshes; meshes *= 10)
+            benchmarkParse(meshes, work_directory);
+    }
+    catch (const std::exception& e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        result = EXIT_FAILURE;
+    }
+
+    std::error_code error;
+    std::filesystem::remove_all(work_directory, error);
+    return result;
+}
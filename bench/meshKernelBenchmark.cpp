@@ -0,0 +1,223 @@
+//Benchmarks the mesh post-processing kernels of the import and deletion list parsing on deterministic synthetic data.
+//Usage: meshKernelBenchmark [max triangles, default 10000000]
+#include "meshNormals.h"
+#include "runtimeIdList.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+    std::atomic<uint64_t> allocationCount{ 0 };
+    std::atomic<uint64_t> allocatedBytes{ 0 };
+}
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (auto ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+    //PRIM submeshes use 16 bit indices, larger meshes are split into grids of at most this many quads per side.
+    constexpr int MAX_GRID_QUADS = 180;
+    constexpr double MIN_MEASURE_SECONDS = 0.25;
+
+    struct Submesh {
+        std::vector<unsigned short> indices;
+        std::vector<float> positions;
+        //glTF space normals, as the importer sees them before conversion.
+        std::vector<float> normals;
+    };
+
+    struct SyntheticMesh {
+        std::vector<Submesh> submeshes;
+        size_t vertices = 0;
+        size_t triangles = 0;
+    };
+
+    //Wavy height field grid with analytic normals, identical for every run.
+    Submesh makeGrid(int quads, float offset) {
+        Submesh mesh;
+        const int side = quads + 1;
+        mesh.positions.reserve(side * side * 3);
+        mesh.normals.reserve(side * side * 3);
+        for (int y = 0; y < side; ++y) {
+            for (int x = 0; x < side; ++x) {
+                const float u = offset + x * 0.1f;
+                const float v = y * 0.1f;
+                const float h = 0.25f * std::sin(u) * std::cos(v);
+                mesh.positions.insert(mesh.positions.end(), { u, h, v });
+
+                const float dx = 0.25f * std::cos(u) * std::cos(v);
+                const float dz = -0.25f * std::sin(u) * std::sin(v);
+                const float length = std::sqrt(dx * dx + 1.0f + dz * dz);
+                mesh.normals.insert(mesh.normals.end(), { -dx / length, 1.0f / length, -dz / length });
+            }
+        }
+
+        mesh.indices.reserve(quads * quads * 6);
+        for (int y = 0; y < quads; ++y) {
+            for (int x = 0; x < quads; ++x) {
+                const auto i = static_cast<unsigned short>(y * side + x);
+                const auto right = static_cast<unsigned short>(i + 1);
+                const auto below = static_cast<unsigned short>(i + side);
+                const auto diagonal = static_cast<unsigned short>(below + 1);
+                mesh.indices.insert(mesh.indices.end(), { i, below, right, right, below, diagonal });
+            }
+        }
+        return mesh;
+    }
+
+    SyntheticMesh makeMesh(size_t target_triangles) {
+        SyntheticMesh mesh;
+        const size_t full_grid_triangles = 2 * MAX_GRID_QUADS * MAX_GRID_QUADS;
+        while (mesh.triangles < target_triangles) {
+            const size_t remaining = target_triangles - mesh.triangles;
+            const int quads = remaining >= full_grid_triangles ? MAX_GRID_QUADS :
+                std::max(1, static_cast<int>(std::sqrt(remaining / 2.0)));
+            mesh.submeshes.push_back(makeGrid(quads, static_cast<float>(mesh.submeshes.size())));
+            mesh.vertices += mesh.submeshes.back().positions.size() / 3;
+            mesh.triangles += mesh.submeshes.back().indices.size() / 3;
+        }
+        return mesh;
+    }
+
+    struct Measurement {
+        double seconds = 0.0;
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+    };
+
+    //Best time of repeated runs, allocations of a single run.
+    Measurement measure(const std::function<void()>& run) {
+        Measurement best;
+        best.seconds = 1e30;
+        double total = 0.0;
+        int repetitions = 0;
+        do {
+            const auto allocations = allocationCount.load();
+            const auto bytes = allocatedBytes.load();
+            const auto start = std::chrono::steady_clock::now();
+            run();
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (seconds < best.seconds) {
+                best.seconds = seconds;
+                best.allocations = allocationCount.load() - allocations;
+                best.bytes = allocatedBytes.load() - bytes;
+            }
+            total += seconds;
+            ++repetitions;
+        } while (total < MIN_MEASURE_SECONDS && repetitions < 1000);
+        return best;
+    }
+
+    void printHeader(const char* unit) {
+        printf("%-22s %12s %10s %14s %14s %10s %10s\n", "Kernel", unit, "ms", "vertices/s", "triangles/s", "allocs", "MiB alloc");
+    }
+
+    void printRow(const char* kernel, size_t size, const Measurement& m, size_t vertices, size_t triangles) {
+        printf("%-22s %12zu %10.3f %14.3e %14.3e %10llu %10.2f\n", kernel, size, m.seconds * 1e3,
+            vertices / m.seconds, triangles / m.seconds,
+            static_cast<unsigned long long>(m.allocations), m.bytes / (1024.0 * 1024.0));
+    }
+
+    void benchmarkMesh(size_t target_triangles) {
+        auto mesh = makeMesh(target_triangles);
+        volatile float sink = 0.0f;
+
+        std::vector<std::vector<float>> reference_normals;
+        for (const auto& submesh : mesh.submeshes)
+            reference_normals.push_back(calculateNormals(submesh.indices, submesh.positions));
+
+        auto m = measure([&]() {
+            for (const auto& submesh : mesh.submeshes)
+                sink = sink + calculateNormals(submesh.indices, submesh.positions)[0];
+        });
+        printRow("calculateNormals", mesh.triangles, m, mesh.vertices, mesh.triangles);
+
+        m = measure([&]() {
+            for (size_t i = 0; i < mesh.submeshes.size(); ++i)
+                sink = sink + findTransformation(mesh.submeshes[i].normals, reference_normals[i])[0];
+        });
+        printRow("findTransformation", mesh.triangles, m, mesh.vertices, mesh.triangles);
+
+        m = measure([&]() {
+            for (auto& submesh : mesh.submeshes)
+                convertNormals(submesh.normals, false, true, false);
+        });
+        printRow("convertNormals", mesh.triangles, m, mesh.vertices, mesh.triangles);
+
+        m = measure([&]() {
+            for (auto& submesh : mesh.submeshes)
+                reorientNormals(submesh.indices, submesh.positions, submesh.normals);
+        });
+        printRow("reorientNormals", mesh.triangles, m, mesh.vertices, mesh.triangles);
+    }
+
+    void benchmarkIdParsing(size_t id_count) {
+        std::string text;
+        text.reserve(id_count * 18);
+        uint64_t state = 0x9E3779B97F4A7C15ull;
+        char id[32];
+        for (size_t i = 0; i < id_count; ++i) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            snprintf(id, sizeof(id), "%016llx, ", static_cast<unsigned long long>(state));
+            text += id;
+        }
+
+        size_t parsed = 0;
+        auto m = measure([&]() {
+            auto ids = parseRuntimeIds(text);
+            sortUniqueRuntimeIds(ids);
+            parsed = ids.size();
+        });
+        printf("%-22s %12zu %10.3f %14.3e %14.1f %10llu %10.2f\n", "parseRuntimeIds+unique", parsed, m.seconds * 1e3,
+            id_count / m.seconds, text.size() / (1024.0 * 1024.0) / m.seconds,
+            static_cast<unsigned long long>(m.allocations), m.bytes / (1024.0 * 1024.0));
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const size_t max_triangles = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+
+    printHeader("triangles");
+    for (size_t triangles = 1000; triangles <= max_triangles; triangles *= 10)
+        benchmarkMesh(triangles);
+
+    printf("\n%-22s %12s %10s %14s %14s %10s %10s\n", "Kernel", "ids", "ms", "ids/s", "MiB/s", "allocs", "MiB alloc");
+    for (size_t ids = 1000; ids <= 1000000; ids *= 10)
+        benchmarkIdParsing(ids);
+    return 0;
+}
@@ -0,0 +1,247 @@
+//End to end benchmark of the glTF side of import and export on synthetic assets, no game files required.
+//Every configuration runs in a child process of its own so the peak RSS of one doesn't hide that of the next.
+//Usage: pipelineBenchmark [max triangles, default 1000000] [texture size, default 1024] [work directory]
+#include "syntheticAssets.h"
+#include "gltfDocument.h"
+#include "gltfFilter.h"
+#include "gltfOptimization.h"
+#include "gltfQuantization.h"
+#include "gltfSkinning.h"
+#include "rpkgMerge.h"
+
+#include <QJsonArray>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    constexpr int LOD_LEVELS = 3;
+    //Every n-th joint is left out of the rig so unmapped influences get dropped as well.
+    constexpr int UNMAPPED_JOINT_INTERVAL = 16;
+    constexpr uint64_t SYNTHETIC_ID_BASE = 0x00A0000000000000ull;
+    constexpr uint64_t SHARED_ID_OFFSET = 0x100;
+
+    struct Configuration {
+        size_t triangles = 0;
+        int submeshes = 1;
+        bool skinned = false;
+        int texture_size = 0;
+    };
+
+    //Peak resident set size of the process so far.
+    double peakRssMiB() {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss / 1024.0;
+    }
+
+    uint64_t fileSizes(const std::vector<std::filesystem::path>& files) {
+        uint64_t size = 0;
+        for (const auto& file : files)
+            size += std::filesystem::file_size(file);
+        return size;
+    }
+
+    class StageTable {
+    public:
+        //Runs a stage, which returns the number of bytes it wrote, and prints its row.
+        void run(const char* name, const std::function<uint64_t()>& stage) {
+            const auto start = std::chrono::steady_clock::now();
+            const auto bytes = stage();
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            total_seconds += seconds;
+            total_bytes += bytes;
+            printf("  %-24s %10.1f %12.2f %14.1f\n", name, seconds * 1e3, bytes / (1024.0 * 1024.0), peakRssMiB());
+            fflush(stdout);
+        }
+
+        void printTotal() const {
+            printf("  %-24s %10.1f %12.2f %14.1f\n", "Total", total_seconds * 1e3, total_bytes / (1024.0 * 1024.0), peakRssMiB());
+        }
+
+    private:
+        double total_seconds = 0.0;
+        uint64_t total_bytes = 0;
+    };
+
+    //Only product code is timed, writing the synthetic glTF and patch archives is fixture setup and stays out of the table.
+    //Import: synthetic glTF -> prepared glTF, then the patch tool merge of two patch archives built from it.
+    //Export: starts from the staged glTF, not a PRIM, and covers the post-processing into a filtered, quantized .glb
+    //that postProcessGltf applies to exported files. The PRIM to glTF conversion of GLTFExporter isn't included.
+    void runConfiguration(const Configuration& configuration, const std::filesystem::path& directory) {
+        printf("\n%zu triangles, %d submeshes, %s, %s\n", configuration.triangles, configuration.submeshes,
+            configuration.skinned ? "skinned" : "static",
+            configuration.texture_size ? (std::to_string(configuration.texture_size) + "px textures").c_str() : "untextured");
+        printf("  %-24s %10s %12s %14s\n", "Stage", "ms", "MiB written", "peak RSS MiB");
+
+        StageTable table;
+        SyntheticGltfOptions options;
+        options.triangles = configuration.triangles;
+        options.submeshes = configuration.submeshes;
+        options.skinned = configuration.skinned;
+        options.texture_size = configuration.texture_size;
+
+        const auto asset = writeSyntheticGltf(directory, "synthetic", options);
+
+        const auto staged_path = directory / "staged.gltf";
+        {
+            std::unique_ptr<GltfDocument> document;
+            table.run("Load glTF", [&]() {
+                document = std::make_unique<GltfDocument>(asset.gltf_path);
+                return uint64_t(0);
+            });
+            table.run("Dequantize", [&]() {
+                dequantizeGltf(*document);
+                return uint64_t(0);
+            });
+            if (configuration.skinned) {
+                table.run("Process skin weights", [&]() {
+                    auto bone_index = [](const std::string& name) -> int {
+                        const int joint = std::atoi(name.c_str() + name.find('_') + 1);
+                        return joint % UNMAPPED_JOINT_INTERVAL == UNMAPPED_JOINT_INTERVAL - 1 ? -1 : joint;
+                    };
+                    processGltfSkinWeights(*document, bone_index);
+                    return uint64_t(0);
+                });
+            }
+            table.run("Weld vertices", [&]() {
+                weldGltfVertices(*document, WeldTolerances());
+                return uint64_t(0);
+            });
+            table.run("Recalculate normals", [&]() {
+                recalculateGltfNormals(*document, true);
+                return uint64_t(0);
+            });
+            table.run("Generate LODs", [&]() {
+                std::unordered_map<std::string, int> level_counts;
+                for (const auto& mesh : document->json().value("meshes").toArray())
+                    level_counts[mesh.toObject().value("name").toString().toStdString()] = LOD_LEVELS;
+                generateGltfLods(*document, level_counts);
+                return uint64_t(0);
+            });
+            table.run("Optimize vertex cache", [&]() {
+                optimizeGltfVertexCache(*document);
+                return uint64_t(0);
+            });
+            table.run("Save staged glTF", [&]() {
+                document->saveGltf(staged_path);
+                return fileSizes({ staged_path, directory / "staged.bin" });
+            });
+        }
+
+        //The staged buffer stands in for the serialized PRIM, every texture for a TEXD.
+        std::vector<SyntheticResource> resources;
+        resources.push_back({ SYNTHETIC_ID_BASE, "PRIM", directory / "staged.bin" });
+        if (!asset.rig_path.empty())
+            resources.push_back({ SYNTHETIC_ID_BASE + 1, "BORG", asset.rig_path });
+        for (size_t i = 0; i < asset.texture_paths.size(); ++i)
+            resources.push_back({ SYNTHETIC_ID_BASE + 2 + i, "TEXD", asset.texture_paths[i] });
+
+        const auto patch_path = directory / "chunk0patch1.rpkg";
+        const auto next_patch_path = directory / "chunk0patch2.rpkg";
+        const auto merged_path = directory / "chunk0patch3.rpkg";
+        writeSyntheticPatch(patch_path, resources, { SYNTHETIC_ID_BASE + 0xFF });
+        //A second asset sharing all blobs with the first, they get deduplicated by the merge.
+        auto shared_resources = resources;
+        for (auto& resource : shared_resources)
+            resource.id += SHARED_ID_OFFSET;
+        writeSyntheticPatch(next_patch_path, shared_resources, {});
+        table.run("Merge patches", [&]() {
+            return mergeRpkgArchives({ patch_path, next_patch_path }, merged_path).bytes_written;
+        });
+
+        const auto glb_path = directory / "exported.glb";
+        {
+            std::unique_ptr<GltfDocument> document;
+            table.run("Load staged glTF", [&]() {
+                document = std::make_unique<GltfDocument>(staged_path);
+                return uint64_t(0);
+            });
+            table.run("Filter LODs", [&]() {
+                filterGltfMeshes(*document, [](const std::string& name) {
+                    int level = 0;
+                    lodBaseName(name, &level);
+                    return level == 0;
+                });
+                return uint64_t(0);
+            });
+            table.run("Quantize", [&]() {
+                quantizeGltf(*document);
+                return uint64_t(0);
+            });
+            table.run("Compact", [&]() {
+                document->compact();
+                return uint64_t(0);
+            });
+            table.run("Save .glb", [&]() {
+                document->saveGlb(glb_path);
+                return std::filesystem::file_size(glb_path);
+            });
+        }
+
+        table.printTotal();
+    }
+
+    //Returns false if the configuration failed or crashed.
+    bool runInChildProcess(const Configuration& configuration, const std::filesystem::path& directory) {
+        fflush(stdout);
+        const auto pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return false;
+        }
+
+        if (pid == 0) {
+            int result = EXIT_SUCCESS;
+            try {
+                std::filesystem::create_directories(directory);
+                runConfiguration(configuration, directory);
+            }
+            catch (const std::exception& e) {
+                fprintf(stderr, "Error: %s\n", e.what());
+                result = EXIT_FAILURE;
+            }
+            fflush(stdout);
+            std::error_code ec;
+            std::filesystem::remove_all(directory, ec);
+            _exit(result);
+        }
+
+        int status = 0;
+        waitpid(pid, &status, 0);
+        return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const size_t max_triangles = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const int texture_size = argc > 2 ? std::atoi(argv[2]) : 1024;
+    const auto work_directory = argc > 3 ? std::filesystem::path(argv[3]) :
+        std::filesystem::temp_directory_path() / ("glacierPrimIOBench" + std::to_string(getpid()));
+
+    bool success = true;
+    for (size_t triangles = 10000; triangles <= max_triangles; triangles *= 10) {
+        for (const int submeshes : { 1, 32 }) {
+            for (const bool skinned : { false, true }) {
+                Configuration configuration;
+                configuration.triangles = triangles;
+                configuration.submeshes = submeshes;
+                configuration.skinned = skinned;
+                configuration.texture_size = texture_size;
+                success &= runInChildProcess(configuration, work_directory);
+            }
+        }
+    }
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
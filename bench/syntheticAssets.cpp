@@ -0,0 +1,356 @@
+#include "syntheticAssets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    constexpr int INFLUENCES = 8;
+    constexpr size_t COPY_CHUNK_SIZE = 1 << 20;
+    constexpr int UNSIGNED_SHORT = 5123;
+    constexpr int UNSIGNED_INT = 5125;
+    constexpr int FLOAT = 5126;
+    constexpr int ARRAY_BUFFER = 34962;
+    constexpr int ELEMENT_ARRAY_BUFFER = 34963;
+
+    template<typename T>
+    void write(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    //Collects the binary buffer and the matching bufferViews and accessors of the document.
+    class GltfBufferBuilder {
+    public:
+        int addAccessor(const void* data, size_t size, size_t count, int component_type, const char* type, int target,
+            const std::vector<float>& min = {}, const std::vector<float>& max = {}) {
+            while (bin.size() % 4)
+                bin.push_back(0);
+
+            const auto offset = bin.size();
+            bin.resize(offset + size);
+            memcpy(bin.data() + offset, data, size);
+
+            if (views.tellp() > 0)
+                views << ",";
+            views << "{\"buffer\":0,\"byteOffset\":" << offset << ",\"byteLength\":" << size;
+            if (target)
+                views << ",\"target\":" << target;
+            views << "}";
+
+            if (accessors.tellp() > 0)
+                accessors << ",";
+            accessors << "{\"bufferView\":" << viewCount << ",\"componentType\":" << component_type
+                << ",\"count\":" << count << ",\"type\":\"" << type << "\"";
+            if (!min.empty())
+                accessors << ",\"min\":" << floatArray(min) << ",\"max\":" << floatArray(max);
+            accessors << "}";
+
+            ++viewCount;
+            return accessorCount++;
+        }
+
+        template<typename T>
+        int addAccessor(const std::vector<T>& data, size_t count, int component_type, const char* type, int target,
+            const std::vector<float>& min = {}, const std::vector<float>& max = {}) {
+            return addAccessor(data.data(), data.size() * sizeof(T), count, component_type, type, target, min, max);
+        }
+
+        static std::string floatArray(const std::vector<float>& values) {
+            std::ostringstream out;
+            out.precision(9);
+            out << "[";
+            for (size_t i = 0; i < values.size(); ++i)
+                out << (i ? "," : "") << values[i];
+            out << "]";
+            return out.str();
+        }
+
+        std::vector<char> bin;
+        std::ostringstream views;
+        std::ostringstream accessors;
+
+    private:
+        int viewCount = 0;
+        int accessorCount = 0;
+    };
+
+    struct Grid {
+        std::vector<float> positions;
+        std::vector<float> normals;
+        std::vector<float> uvs;
+        std::vector<uint16_t> joints[2];
+        std::vector<float> weights[2];
+        std::vector<uint32_t> indices;
+        std::vector<float> min{ 1e30f, 1e30f, 1e30f };
+        std::vector<float> max{ -1e30f, -1e30f, -1e30f };
+    };
+
+    //Wavy height field with four vertices per quad, influences slide along the chain of joints with x.
+    Grid makeGrid(int quads, float offset, int joint_count) {
+        Grid grid;
+        const size_t vertex_count = static_cast<size_t>(quads) * quads * 4;
+        grid.positions.reserve(vertex_count * 3);
+        grid.normals.reserve(vertex_count * 3);
+        grid.uvs.reserve(vertex_count * 2);
+        grid.indices.reserve(static_cast<size_t>(quads) * quads * 6);
+
+        float influence_weights[INFLUENCES];
+        float weight_sum = 0.0f;
+        for (int k = 0; k < INFLUENCES; ++k)
+            weight_sum += static_cast<float>(INFLUENCES - k);
+        for (int k = 0; k < INFLUENCES; ++k)
+            influence_weights[k] = (INFLUENCES - k) / weight_sum;
+
+        for (int y = 0; y < quads; ++y) {
+            for (int x = 0; x < quads; ++x) {
+                const auto first = static_cast<uint32_t>(grid.positions.size() / 3);
+                for (int corner = 0; corner < 4; ++corner) {
+                    const int cx = x + (corner & 1);
+                    const int cy = y + (corner >> 1);
+                    const float u = offset + cx * 0.1f;
+                    const float v = cy * 0.1f;
+                    const float h = 0.25f * std::sin(u) * std::cos(v);
+                    grid.positions.insert(grid.positions.end(), { u, h, v });
+                    const float p[3] = { u, h, v };
+                    for (int i = 0; i < 3; ++i) {
+                        grid.min[i] = std::min(grid.min[i], p[i]);
+                        grid.max[i] = std::max(grid.max[i], p[i]);
+                    }
+
+                    const float dx = 0.25f * std::cos(u) * std::cos(v);
+                    const float dz = -0.25f * std::sin(u) * std::sin(v);
+                    const float length = std::sqrt(dx * dx + 1.0f + dz * dz);
+                    grid.normals.insert(grid.normals.end(), { -dx / length, 1.0f / length, -dz / length });
+                    grid.uvs.insert(grid.uvs.end(), { static_cast<float>(cx) / quads, static_cast<float>(cy) / quads });
+
+                    if (joint_count) {
+                        const int base = cx * joint_count / (quads + 1);
+                        for (int k = 0; k < INFLUENCES; ++k) {
+                            grid.joints[k / 4].push_back(static_cast<uint16_t>((base + k) % joint_count));
+                            grid.weights[k / 4].push_back(influence_weights[k]);
+                        }
+                    }
+                }
+                grid.indices.insert(grid.indices.end(), { first, first + 2, first + 1, first + 1, first + 2, first + 3 });
+            }
+        }
+        return grid;
+    }
+
+    uint64_t writeFile(const std::filesystem::path& path, const void* data, size_t size) {
+        std::ofstream out(path, std::ios::binary);
+        out.write(static_cast<const char*>(data), size);
+        if (!out)
+            throw std::runtime_error("Failed to write " + path.generic_string());
+        return size;
+    }
+
+    //Uncompressed, top-left origin 32 bit TGA.
+    uint64_t writeTga(const std::filesystem::path& path, int size, bool normal_map) {
+        std::ofstream out(path, std::ios::binary);
+        if (!out)
+            throw std::runtime_error("Failed to open " + path.generic_string() + " for writing");
+
+        const uint8_t header[18] = { 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            static_cast<uint8_t>(size & 0xFF), static_cast<uint8_t>(size >> 8),
+            static_cast<uint8_t>(size & 0xFF), static_cast<uint8_t>(size >> 8), 32, 0x28 };
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+        std::vector<uint8_t> row(static_cast<size_t>(size) * 4);
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                uint8_t* pixel = &row[x * 4];
+                if (normal_map) {
+                    //BGRA
+                    pixel[0] = 255;
+                    pixel[1] = static_cast<uint8_t>(128 + 64 * std::sin(y * 0.05f));
+                    pixel[2] = static_cast<uint8_t>(128 + 64 * std::sin(x * 0.05f));
+                }
+                else {
+                    const bool checker = ((x / 32) ^ (y / 32)) & 1;
+                    pixel[0] = static_cast<uint8_t>(x);
+                    pixel[1] = static_cast<uint8_t>(y);
+                    pixel[2] = checker ? 220 : 40;
+                }
+                pixel[3] = 255;
+            }
+            out.write(reinterpret_cast<const char*>(row.data()), row.size());
+        }
+        if (!out)
+            throw std::runtime_error("Failed to write " + path.generic_string());
+        return sizeof(header) + static_cast<uint64_t>(size) * size * 4;
+    }
+}
+
+SyntheticGltf writeSyntheticGltf(const std::filesystem::path& directory, const std::string& name, const SyntheticGltfOptions& options) {
+    if (options.submeshes < 1)
+        throw std::runtime_error("Synthetic assets need at least one submesh");
+    if (options.texture_size < 0 || options.texture_size > 0xFFFF)
+        throw std::runtime_error("Unsupported texture size");
+
+    SyntheticGltf asset;
+    asset.gltf_path = directory / (name + ".gltf");
+
+    const int joint_count = options.skinned ? std::max(1, options.joints) : 0;
+    const size_t submesh_triangles = std::max<size_t>(2, options.triangles / options.submeshes);
+    const int quads = std::max(1, static_cast<int>(std::lround(std::sqrt(submesh_triangles / 2.0))));
+
+    GltfBufferBuilder buffer;
+    std::ostringstream meshes;
+    std::ostringstream nodes;
+    std::ostringstream scene_nodes;
+    for (int s = 0; s < options.submeshes; ++s) {
+        const auto grid = makeGrid(quads, static_cast<float>(s) * (quads + 2) * 0.1f, joint_count);
+        const auto vertex_count = grid.positions.size() / 3;
+        asset.vertices += vertex_count;
+        asset.triangles += grid.indices.size() / 3;
+
+        std::ostringstream attributes;
+        attributes << "\"POSITION\":" << buffer.addAccessor(grid.positions, vertex_count, FLOAT, "VEC3", ARRAY_BUFFER, grid.min, grid.max)
+            << ",\"NORMAL\":" << buffer.addAccessor(grid.normals, vertex_count, FLOAT, "VEC3", ARRAY_BUFFER)
+            << ",\"TEXCOORD_0\":" << buffer.addAccessor(grid.uvs, vertex_count, FLOAT, "VEC2", ARRAY_BUFFER);
+        if (joint_count) {
+            for (int set = 0; set < 2; ++set) {
+                attributes << ",\"JOINTS_" << set << "\":" << buffer.addAccessor(grid.joints[set], vertex_count, UNSIGNED_SHORT, "VEC4", ARRAY_BUFFER)
+                    << ",\"WEIGHTS_" << set << "\":" << buffer.addAccessor(grid.weights[set], vertex_count, FLOAT, "VEC4", ARRAY_BUFFER);
+            }
+        }
+
+        int indices;
+        if (vertex_count <= 0xFFFF) {
+            const std::vector<uint16_t> short_indices(grid.indices.begin(), grid.indices.end());
+            indices = buffer.addAccessor(short_indices, short_indices.size(), UNSIGNED_SHORT, "SCALAR", ELEMENT_ARRAY_BUFFER);
+        }
+        else {
+            indices = buffer.addAccessor(grid.indices, grid.indices.size(), UNSIGNED_INT, "SCALAR", ELEMENT_ARRAY_BUFFER);
+        }
+
+        const auto mesh_name = name + "_" + std::to_string(s);
+        meshes << (s ? "," : "") << "{\"name\":\"" << mesh_name << "\",\"primitives\":[{\"attributes\":{" << attributes.str()
+            << "},\"indices\":" << indices << (options.texture_size ? ",\"material\":0" : "") << "}]}";
+        nodes << (s ? "," : "") << "{\"name\":\"" << mesh_name << "\",\"mesh\":" << s << (joint_count ? ",\"skin\":0" : "") << "}";
+        scene_nodes << (s ? "," : "") << s;
+    }
+
+    std::ostringstream skins;
+    if (joint_count) {
+        std::vector<float> inverse_bind_matrices(static_cast<size_t>(joint_count) * 16, 0.0f);
+        std::vector<char> rig(static_cast<size_t>(joint_count) * (16 * sizeof(float) + 32), 0);
+        for (int j = 0; j < joint_count; ++j) {
+            float* matrix = &inverse_bind_matrices[j * 16];
+            matrix[0] = matrix[5] = matrix[10] = matrix[15] = 1.0f;
+            matrix[13] = -0.1f * j;
+
+            char* rig_entry = &rig[j * (16 * sizeof(float) + 32)];
+            memcpy(rig_entry, matrix, 16 * sizeof(float));
+            snprintf(rig_entry + 16 * sizeof(float), 32, "bone_%d", j);
+
+            const int node = options.submeshes + j;
+            nodes << ",{\"name\":\"bone_" << j << "\",\"translation\":[0," << (j ? 0.1f : 0.0f) << ",0]";
+            if (j + 1 < joint_count)
+                nodes << ",\"children\":[" << node + 1 << "]";
+            nodes << "}";
+        }
+        scene_nodes << "," << options.submeshes;
+
+        const auto ibm = buffer.addAccessor(inverse_bind_matrices, joint_count, FLOAT, "MAT4", 0);
+        skins << ",\"skins\":[{\"inverseBindMatrices\":" << ibm << ",\"skeleton\":" << options.submeshes << ",\"joints\":[";
+        for (int j = 0; j < joint_count; ++j)
+            skins << (j ? "," : "") << options.submeshes + j;
+        skins << "]}]";
+
+        asset.rig_path = directory / (name + "_rig.bin");
+        asset.bytes_written += writeFile(asset.rig_path, rig.data(), rig.size());
+    }
+
+    std::ostringstream materials;
+    if (options.texture_size) {
+        for (const auto* suffix : { "_diffuse.tga", "_normal.tga" }) {
+            asset.texture_paths.push_back(directory / (name + suffix));
+            asset.bytes_written += writeTga(asset.texture_paths.back(), options.texture_size, asset.texture_paths.size() == 2);
+        }
+        materials << ",\"images\":[{\"uri\":\"" << name << "_diffuse.tga\"},{\"uri\":\"" << name << "_normal.tga\"}]"
+            << ",\"textures\":[{\"source\":0},{\"source\":1}]"
+            << ",\"materials\":[{\"name\":\"" << name << "_material\",\"pbrMetallicRoughness\":{\"baseColorTexture\":{\"index\":0}},"
+            << "\"normalTexture\":{\"index\":1}}]";
+    }
+
+    const auto bin_name = name + ".bin";
+    std::ostringstream json;
+    json << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"GlacierPrimIO synthetic asset\"},"
+        << "\"scene\":0,\"scenes\":[{\"nodes\":[" << scene_nodes.str() << "]}],"
+        << "\"nodes\":[" << nodes.str() << "],"
+        << "\"meshes\":[" << meshes.str() << "]"
+        << skins.str() << materials.str() << ","
+        << "\"buffers\":[{\"uri\":\"" << bin_name << "\",\"byteLength\":" << buffer.bin.size() << "}],"
+        << "\"bufferViews\":[" << buffer.views.str() << "],"
+        << "\"accessors\":[" << buffer.accessors.str() << "]}";
+
+    const auto json_text = json.str();
+    asset.bytes_written += writeFile(asset.gltf_path, json_text.data(), json_text.size());
+    asset.bytes_written += writeFile(directory / bin_name, buffer.bin.data(), buffer.bin.size());
+    return asset;
+}
+
+uint64_t writeSyntheticPatch(const std::filesystem::path& path, const std::vector<SyntheticResource>& resources, const std::vector<uint64_t>& deletion_list) {
+    constexpr char RPKG_MAGIC[4] = { 'G', 'K', 'P', 'R' };
+    constexpr size_t HASH_ENTRY_SIZE = 8 + 8 + 4;
+    constexpr size_t RESOURCE_INFO_SIZE = 4 * 6;
+
+    std::vector<uint64_t> sizes;
+    for (const auto& resource : resources) {
+        sizes.push_back(std::filesystem::file_size(resource.source));
+        if (sizes.back() > UINT32_MAX || resource.type.size() != 4)
+            throw std::runtime_error("Unsupported synthetic resource " + resource.source.generic_string());
+    }
+
+    const uint64_t hash_table_size = resources.size() * HASH_ENTRY_SIZE;
+    const uint64_t resource_table_size = resources.size() * RESOURCE_INFO_SIZE;
+    const uint64_t header_size = sizeof(RPKG_MAGIC) + 4 * sizeof(uint32_t) + deletion_list.size() * sizeof(uint64_t);
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+        throw std::runtime_error("Failed to open " + path.generic_string() + " for writing");
+
+    out.write(RPKG_MAGIC, sizeof(RPKG_MAGIC));
+    write(out, static_cast<uint32_t>(resources.size()));
+    write(out, static_cast<uint32_t>(hash_table_size));
+    write(out, static_cast<uint32_t>(resource_table_size));
+    write(out, static_cast<uint32_t>(deletion_list.size()));
+    out.write(reinterpret_cast<const char*>(deletion_list.data()), deletion_list.size() * sizeof(uint64_t));
+
+    uint64_t offset = header_size + hash_table_size + resource_table_size;
+    for (size_t i = 0; i < resources.size(); ++i) {
+        write(out, resources[i].id);
+        write(out, offset);
+        write(out, uint32_t(0));
+        offset += sizes[i];
+    }
+
+    for (size_t i = 0; i < resources.size(); ++i) {
+        //Types are stored as little endian integers, PRIM reads MIRP.
+        std::string type(resources[i].type.rbegin(), resources[i].type.rend());
+        out.write(type.data(), 4);
+        write(out, uint32_t(0));
+        write(out, uint32_t(0));
+        write(out, static_cast<uint32_t>(sizes[i]));
+        write(out, static_cast<uint32_t>(sizes[i]));
+        write(out, uint32_t(0));
+    }
+
+    std::vector<char> buffer(COPY_CHUNK_SIZE);
+    for (const auto& resource : resources) {
+        std::ifstream in(resource.source, std::ios::binary);
+        while (in) {
+            in.read(buffer.data(), buffer.size());
+            out.write(buffer.data(), in.gcount());
+        }
+    }
+    if (!out)
+        throw std::runtime_error("Failed to write " + path.generic_string());
+    return offset;
+}
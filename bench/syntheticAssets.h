@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+//Deterministic synthetic inputs for the pipeline benchmark. Everything is written without Qt or GlacierFormats.
+struct SyntheticGltfOptions {
+    int submeshes = 1;
+    //Total triangle count, split evenly over the submeshes.
+    size_t triangles = 100000;
+    //Adds a chain of joints and 8 influences per vertex, more than PRIMs support, so limiting has work to do.
+    bool skinned = false;
+    int joints = 64;
+    //Edge length of the diffuse and normal map, 0 for an untextured asset.
+    int texture_size = 1024;
+};
+
+struct SyntheticGltf {
+    std::filesystem::path gltf_path;
+    std::vector<std::filesystem::path> texture_paths;
+    //Stand-in for the BORG of the rig, bind matrices and joint names of all joints. Empty for unskinned assets.
+    std::filesystem::path rig_path;
+    size_t vertices = 0;
+    size_t triangles = 0;
+    uint64_t bytes_written = 0;
+};
+
+//Writes <name>.gltf, <name>.bin and the textures as uncompressed .tga files into directory. Every submesh is a wavy grid
+//mesh of its own with unwelded quads, like DCC exports with per face attributes, so welding gets a realistic workload.
+SyntheticGltf writeSyntheticGltf(const std::filesystem::path& directory, const std::string& name, const SyntheticGltfOptions& options);
+
+struct SyntheticResource {
+    uint64_t id = 0;
+    //Resource type as written in the game files, e.g. "PRIM".
+    std::string type;
+    //File whose content is stored uncompressed as the resource blob.
+    std::filesystem::path source;
+};
+
+//Writes an RPKG v1 patch archive holding the resources and deletion list. The blobs are opaque fixtures standing in for
+//serialized PRIM/BORG/TEXD resources of matching size. Returns the number of bytes written.
+uint64_t writeSyntheticPatch(const std::filesystem::path& path, const std::vector<SyntheticResource>& resources, const std::vector<uint64_t>& deletion_list);
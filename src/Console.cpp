@@ -1,45 +1,183 @@
 #include "Console.h"
 
-ConsoleWidget::ConsoleWidget(QWidget* parent) : QWidget(parent) {
-    text = new QTextEdit(this);
+#include <chrono>
+
+namespace {
+    constexpr int DRAIN_INTERVAL_MS = 50;
+    //Upper bound of messages appended per timer tick, keeps the GUI responsive under message floods.
+    constexpr size_t MAX_DRAIN_BATCH = 4096;
+    constexpr int MAX_SCROLLBACK_LINES = 5000;
+    constexpr auto FILE_SINK_INTERVAL = std::chrono::milliseconds(100);
+
+    QColor levelColor(LogLevel level) {
+        switch (level) {
+        case LogLevel::Warning:
+            return QColor(255, 200, 0);
+        case LogLevel::Error:
+            return Qt::red;
+        default:
+            return Qt::white;
+        }
+    }
+
+    const char* levelName(LogLevel level) {
+        switch (level) {
+        case LogLevel::Warning:
+            return "WARNING";
+        case LogLevel::Error:
+            return "ERROR";
+        default:
+            return "STATUS";
+        }
+    }
+}
+
+LogQueue::LogQueue() : head(&stub), tail(&stub) {
 
-    auto boxLayout = new QVBoxLayout(this);
-    boxLayout->addWidget(text);
-    this->setLayout(boxLayout);
 }
 
-ConsoleWidget::~ConsoleWidget() {
+LogQueue::~LogQueue() {
+    while (auto node = popNode())
+        delete node;
+}
 
+void LogQueue::pushNode(Node* node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    auto previous = head.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
 }
 
-void ConsoleWidget::printLine(const char* message, const QColor& color) {
-    printLine(QString(message), color);
+void LogQueue::push(LogMessage message) {
+    auto node = new Node;
+    node->message = std::move(message);
+    pushNode(node);
 }
 
-void ConsoleWidget::printLine(const std::string& message, const QColor& color) {
-    printLine(QString::fromStdString(message), color);
+//Returns nullptr if the queue is empty or a producer is in the middle of linking the next node.
+LogQueue::Node* LogQueue::popNode() {
+    auto current = tail;
+    auto next = current->next.load(std::memory_order_acquire);
+    if (current == &stub) {
+        if (!next)
+            return nullptr;
+        tail = next;
+        current = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next) {
+        tail = next;
+        return current;
+    }
+
+    if (current != head.load(std::memory_order_acquire))
+        return nullptr;
+
+    //current is the last node, the stub takes its place so it can be handed out.
+    pushNode(&stub);
+    next = current->next.load(std::memory_order_acquire);
+    if (next) {
+        tail = next;
+        return current;
+    }
+    return nullptr;
 }
 
-void ConsoleWidget::printLine(const QString& message, const QColor& color) {
-    text->moveCursor(QTextCursor::End);
-    text->setTextColor(color);
-    text->append(message);
-    text->moveCursor(QTextCursor::End);
+size_t LogQueue::pop(std::vector<LogMessage>& out, size_t max_count) {
+    size_t count = 0;
+    for (; count < max_count; ++count) {
+        auto node = popNode();
+        if (!node)
+            break;
+        out.push_back(std::move(node->message));
+        delete node;
+    }
+    return count;
 }
 
-void ConsoleWidget::print(const char* message, const QColor& color) {
-    print(QString(message), color);
+LogFileSink::LogFileSink(const std::filesystem::path& path, LogLevel min_level) : file(path), min_level(min_level) {
+    if (!file)
+        throw std::runtime_error("Failed to open log file " + path.generic_string());
+    writer = std::thread(&LogFileSink::write, this);
 }
 
-void ConsoleWidget::print(const std::string& message, const QColor& color) {
-    print(QString::fromStdString(message), color);
+LogFileSink::~LogFileSink() {
+    stopping = true;
+    writer.join();
 }
 
-void ConsoleWidget::print(const QString& message, const QColor& color) {
-    text->moveCursor(QTextCursor::End);
-    text->setTextColor(color);
-    text->insertPlainText(message);
+LogLevel LogFileSink::minLevel() const {
+    return min_level;
+}
+
+void LogFileSink::push(LogMessage message) {
+    if (message.level >= min_level)
+        queue.push(std::move(message));
+}
+
+void LogFileSink::write() {
+    std::vector<LogMessage> messages;
+    for (;;) {
+        //Read the flag first so messages pushed before the destructor ran are still written.
+        const bool stop = stopping;
+        messages.clear();
+        while (queue.pop(messages, MAX_DRAIN_BATCH) == MAX_DRAIN_BATCH) {}
+
+        for (const auto& message : messages)
+            file << levelName(message.level) << ": " << message.text.toStdString() << '\n';
+        if (messages.size())
+            file.flush();
+
+        if (stop)
+            return;
+        std::this_thread::sleep_for(FILE_SINK_INTERVAL);
+    }
+}
+
+ConsoleWidget::ConsoleWidget(QWidget* parent) : QWidget(parent) {
+    text = new QTextEdit(this);
+    text->setReadOnly(true);
+    //Fixed width so tables like the trace summary line up.
+    text->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    text->document()->setMaximumBlockCount(MAX_SCROLLBACK_LINES);
+
+    auto boxLayout = new QVBoxLayout(this);
+    boxLayout->addWidget(text);
+    this->setLayout(boxLayout);
+
+    drainTimer = new QTimer(this);
+    connect(drainTimer, SIGNAL(timeout()), SLOT(drainLog()));
+    drainTimer->start(DRAIN_INTERVAL_MS);
+}
+
+ConsoleWidget::~ConsoleWidget() {
+
+}
+
+void ConsoleWidget::printMessages(const std::vector<LogMessage>& messages) {
+    //Lines that would be trimmed by the scrollback limit right away aren't inserted at all.
+    const size_t first = messages.size() > MAX_SCROLLBACK_LINES ? messages.size() - MAX_SCROLLBACK_LINES : 0;
+
+    QTextCursor cursor(text->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.beginEditBlock();
+    QTextCharFormat format;
+    for (size_t i = first; i < messages.size(); ++i) {
+        format.setForeground(levelColor(messages[i].level));
+        if (!text->document()->isEmpty() || i != first)
+            cursor.insertBlock();
+        cursor.insertText(messages[i].text, format);
+    }
+    cursor.endEditBlock();
+
     text->moveCursor(QTextCursor::End);
+    text->ensureCursorVisible();
+}
+
+void ConsoleWidget::drainLog() {
+    pending.clear();
+    if (Console::instance().drain(this, pending, MAX_DRAIN_BATCH))
+        printMessages(pending);
 }
 
 Console::Console() {
@@ -55,10 +193,32 @@ void Console::setDestinationWidget(ConsoleWidget* widget) {
     consoleWidget = widget;
 }
 
+void Console::setFileSink(const std::filesystem::path& path, LogLevel min_level) {
+    fileSink = nullptr;
+    ownedFileSink = std::make_unique<LogFileSink>(path, min_level);
+    fileSink = ownedFileSink.get();
+}
+
+void Console::log(LogLevel level, const QString& message) {
+    if (auto sink = fileSink.load())
+        sink->push({ level, message });
+    queue.push({ level, message });
+}
+
+size_t Console::drain(const ConsoleWidget* widget, std::vector<LogMessage>& out, size_t max_count) {
+    if (widget != consoleWidget)
+        return 0;
+    return queue.pop(out, max_count);
+}
+
 void printError(const std::string& msg) {
-    Console::instance().printLine("Error: " + msg, Qt::red);
+    Console::instance().log(LogLevel::Error, QString::fromStdString("Error: " + msg));
+}
+
+void printWarning(const std::string& msg) {
+    Console::instance().log(LogLevel::Warning, QString::fromStdString("Warning: " + msg));
 }
 
 void printStatus(const std::string& msg) {
-    Console::instance().printLine(msg, Qt::white);
-}
\ No newline at end of file
+    Console::instance().log(LogLevel::Status, QString::fromStdString(msg));
+}
@@ -3,49 +3,116 @@
 #include <QWidget>
 #include <QtWidgets>
 
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+//Not upper case, Windows.h defines ERROR.
+enum class LogLevel {
+    Status,
+    Warning,
+    Error
+};
+
+struct LogMessage {
+    LogLevel level = LogLevel::Status;
+    QString text;
+};
+
+//Unbounded multi producer, single consumer queue of log messages (Vyukov's intrusive MPSC queue).
+//push never blocks and is safe from any thread, pop may only be called by one consumer thread.
+class LogQueue {
+public:
+    LogQueue();
+    ~LogQueue();
+
+    LogQueue(const LogQueue&) = delete;
+    LogQueue& operator=(const LogQueue&) = delete;
+
+    void push(LogMessage message);
+    //Moves up to max_count messages into out. Returns the number of moved messages.
+    size_t pop(std::vector<LogMessage>& out, size_t max_count);
+
+private:
+    struct Node {
+        std::atomic<Node*> next{ nullptr };
+        LogMessage message;
+    };
+
+    std::atomic<Node*> head;
+    Node* tail;
+    Node stub;
+
+    void pushNode(Node* node);
+    Node* popNode();
+};
+
+//Writes log messages of at least the given level to a file on its own thread.
+class LogFileSink {
+public:
+    LogFileSink(const std::filesystem::path& path, LogLevel min_level);
+    //Writes all pending messages before returning.
+    ~LogFileSink();
+
+    LogLevel minLevel() const;
+    void push(LogMessage message);
+
+private:
+    LogQueue queue;
+    std::ofstream file;
+    LogLevel min_level;
+    std::atomic<bool> stopping{ false };
+    std::thread writer;
+
+    void write();
+};
+
 class ConsoleWidget : public QWidget {
     Q_OBJECT
 
 private:
     QTextEdit* text;
+    QTimer* drainTimer;
+    std::vector<LogMessage> pending;
 
 public:
     ConsoleWidget(QWidget* parent = nullptr);
     ~ConsoleWidget();
 
-    void printLine(const char* message, const QColor& color);
-    void printLine(const std::string& message, const QColor& color);
-    void printLine(const QString& message, const QColor& color);
+    //Appends a batch of messages as a single edit. GUI thread only, everything else logs through printStatus and co.
+    void printMessages(const std::vector<LogMessage>& messages);
 
-    void print(const char* message, const QColor& color);
-    void print(const std::string& message, const QColor& color);
-    void print(const QString& message, const QColor& color);
+private slots:
+    void drainLog();
 };
 
+//Collects the log of all threads. Messages are queued without locking and appended to the console widget in batches
+//by a GUI thread timer, an optional file sink receives its own copy of every message.
 class Console {
 private:
-    ConsoleWidget* consoleWidget;
+    LogQueue queue;
+    std::atomic<ConsoleWidget*> consoleWidget{ nullptr };
+    std::atomic<LogFileSink*> fileSink{ nullptr };
+    std::unique_ptr<LogFileSink> ownedFileSink;
 
     Console();
 
 public:
     static Console& instance();
 
+    //The widget drains the queue, messages logged before it's set are kept.
     void setDestinationWidget(ConsoleWidget* widget);
+    //Call before any worker threads are started. Throws if the file can't be opened.
+    void setFileSink(const std::filesystem::path& path, LogLevel min_level);
 
-    template<typename T>
-    void printLine(T msg, const QColor& color = Qt::white) {
-        if (consoleWidget)
-            consoleWidget->printLine(msg, color);
-    }
-
-    template<typename T>
-    void print(T msg, const QColor& color = Qt::white) {
-        if (consoleWidget)
-            consoleWidget->print(msg, color);
-    }
-
+    void log(LogLevel level, const QString& message);
+    //Moves queued messages into out, only does so for the destination widget.
+    size_t drain(const ConsoleWidget* widget, std::vector<LogMessage>& out, size_t max_count);
 };
 
 void printError(const std::string& msg);
-void printStatus(const std::string& msg);
\ No newline at end of file
+void printWarning(const std::string& msg);
+void printStatus(const std::string& msg);
@@ -0,0 +1,60 @@
+#include "backgroundJob.h"
+#include "Console.h"
+
+#include <QtConcurrent/qtconcurrentrun.h>
+
+BackgroundJob::BackgroundJob(QObject* parent) : QObject(parent) {
+    connect(&watcher, SIGNAL(finished()), SLOT(watcherFinished()));
+}
+
+bool BackgroundJob::start(std::function<void()> work) {
+    if (isRunning())
+        return false;
+
+    cancelRequested = false;
+    canceled = false;
+    emit started();
+    emit progressChanged(0.0f);
+
+    watcher.setFuture(QtConcurrent::run([this, work = std::move(work)]() {
+        try {
+            work();
+        }
+        catch (const JobCanceled&) {
+            canceled = true;
+        }
+        catch (const std::exception& e) {
+            printError(e.what());
+        }
+    }));
+    return true;
+}
+
+bool BackgroundJob::isRunning() const {
+    return watcher.isRunning();
+}
+
+void BackgroundJob::stage(const QString& name, float progress) {
+    if (cancelRequested)
+        throw JobCanceled();
+    //Emitted from the worker thread, receivers on the GUI thread get queued calls.
+    emit stageChanged(name);
+    emit progressChanged(progress);
+}
+
+bool BackgroundJob::isCancelRequested() const {
+    return cancelRequested;
+}
+
+void BackgroundJob::cancel() {
+    if (isRunning())
+        cancelRequested = true;
+}
+
+void BackgroundJob::watcherFinished() {
+    if (canceled)
+        printError("Canceled");
+    else
+        emit progressChanged(1.0f);
+    emit finished(canceled);
+}
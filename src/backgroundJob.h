@@ -0,0 +1,44 @@
+#pragma once
+#include <QFutureWatcher>
+#include <QObject>
+
+#include <atomic>
+#include <functional>
+
+//Thrown by BackgroundJob::stage once cancellation has been requested, unwinds the work function. Intentionally not
+//derived from std::exception so the error handling of the work function doesn't swallow it.
+struct JobCanceled {};
+
+//Runs a work function on the global thread pool and reports completion through signals instead of blocking the GUI
+//thread. Cancellation is cooperative, the work function marks stage boundaries with stage() which throw JobCanceled
+//once cancel() got called. Only one run at a time, start() is ignored while the job is running.
+class BackgroundJob : public QObject {
+    Q_OBJECT
+
+public:
+    explicit BackgroundJob(QObject* parent = nullptr);
+
+    bool start(std::function<void()> work);
+    bool isRunning() const;
+
+    //Called by the work function. Reports the name and the fraction of the job done at the start of the next stage.
+    void stage(const QString& name, float progress);
+    bool isCancelRequested() const;
+
+public slots:
+    void cancel();
+
+signals:
+    void started();
+    void stageChanged(const QString& name);
+    void progressChanged(float progress);
+    void finished(bool canceled);
+
+private:
+    QFutureWatcher<void> watcher;
+    std::atomic<bool> cancelRequested{ false };
+    std::atomic<bool> canceled{ false };
+
+private slots:
+    void watcherFinished();
+};
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+constexpr uint64_t CONTENT_HASH_SEED = 0xCBF29CE484222325ull;
+
+//64 bit FNV-1a over a byte range. Used to find identical resource payloads, not suitable against malicious input.
+//Pass the hash of the preceding bytes to hash data in chunks.
+inline uint64_t hashContent(const void* data, size_t size, uint64_t hash = CONTENT_HASH_SEED) {
+    const auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
@@ -0,0 +1,856 @@
+#include "gltfDocument.h"
+#include "trace.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QUrl>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    constexpr uint32_t GLB_MAGIC = 0x46546C67; //"glTF"
+    constexpr uint32_t GLB_VERSION = 2;
+    constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+    constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+    //Start of the binary chunk payload and of every buffer inside of it gets aligned to this
+    //so mapped accessor data can be used in place.
+    constexpr size_t GLB_BIN_ALIGNMENT = 16;
+
+    struct GlbHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t length;
+    };
+
+    struct GlbChunkHeader {
+        uint32_t length;
+        uint32_t type;
+    };
+
+    size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+GltfDocument::GltfDocument(const std::filesystem::path& path) : path(path) {
+    TraceSpan span("Load glTF", "io");
+    size_t size = 0;
+    const char* data = mapFile(path, size);
+    span.setBytes(size);
+
+    if (isGlbFile(path)) {
+        loadGlb(data, size);
+        return;
+    }
+
+    QJsonParseError error;
+    auto doc = QJsonDocument::fromJson(QByteArray::fromRawData(data, static_cast<int>(size)), &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject())
+        throw std::runtime_error("Failed to parse glTF json: " + error.errorString().toStdString());
+    root = doc.object();
+
+    loadBuffers(nullptr, 0);
+}
+
+GltfDocument::~GltfDocument() {
+
+}
+
+QJsonObject& GltfDocument::json() {
+    writeBackArrays();
+    return root;
+}
+
+const QJsonObject& GltfDocument::json() const {
+    writeBackArrays();
+    return root;
+}
+
+QJsonArray GltfDocument::array(const QString& key) const {
+    const auto edited = editedArrays.find(key);
+    return edited != editedArrays.end() ? edited->second : root.value(key).toArray();
+}
+
+QJsonArray& GltfDocument::editArray(const QString& key) {
+    auto edited = editedArrays.find(key);
+    if (edited == editedArrays.end())
+        edited = editedArrays.emplace(key, root.value(key).toArray()).first;
+    return edited->second;
+}
+
+void GltfDocument::writeBackArrays() const {
+    for (const auto& [key, edited] : editedArrays)
+        root[key] = edited;
+    editedArrays.clear();
+}
+
+int GltfDocument::bufferCount() const {
+    return static_cast<int>(buffers.size());
+}
+
+const char* GltfDocument::bufferData(int buffer) const {
+    return buffers.at(buffer).data;
+}
+
+size_t GltfDocument::bufferSize(int buffer) const {
+    return buffers.at(buffer).size;
+}
+
+std::vector<std::filesystem::path> GltfDocument::externalFiles() const {
+    std::vector<std::filesystem::path> files;
+    for (const auto& buffer : buffers) {
+        if (!buffer.source.empty())
+            files.push_back(buffer.source);
+    }
+    return files;
+}
+
+const char* GltfDocument::mapFile(const std::filesystem::path& file_path, size_t& size) {
+    auto file = std::make_unique<QFile>(QString::fromStdString(file_path.generic_string()));
+    if (!file->open(QIODevice::ReadOnly))
+        throw std::runtime_error("Failed to open " + file_path.generic_string());
+
+    size = static_cast<size_t>(file->size());
+    if (size == 0)
+        throw std::runtime_error("Empty file " + file_path.generic_string());
+
+    auto data = file->map(0, file->size());
+    if (!data)
+        throw std::runtime_error("Failed to map " + file_path.generic_string());
+
+    mappedFiles.push_back(std::move(file));
+    return reinterpret_cast<const char*>(data);
+}
+
+void GltfDocument::loadGlb(const char* data, size_t size) {
+    if (size < sizeof(GlbHeader) + sizeof(GlbChunkHeader))
+        throw std::runtime_error("Invalid glb file: Truncated header");
+
+    GlbHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != GLB_MAGIC || header.version != GLB_VERSION)
+        throw std::runtime_error("Invalid glb file: Unsupported header");
+    if (header.length > size)
+        throw std::runtime_error("Invalid glb file: Truncated file");
+
+    const char* bin_chunk = nullptr;
+    size_t bin_chunk_size = 0;
+    bool has_json = false;
+
+    size_t offset = sizeof(GlbHeader);
+    while (offset + sizeof(GlbChunkHeader) <= header.length) {
+        GlbChunkHeader chunk;
+        memcpy(&chunk, data + offset, sizeof(chunk));
+        offset += sizeof(chunk);
+        if (offset + chunk.length > header.length)
+            throw std::runtime_error("Invalid glb file: Truncated chunk");
+
+        if (chunk.type == GLB_CHUNK_JSON && !has_json) {
+            QJsonParseError error;
+            auto doc = QJsonDocument::fromJson(QByteArray::fromRawData(data + offset, static_cast<int>(chunk.length)), &error);
+            if (error.error != QJsonParseError::NoError || !doc.isObject())
+                throw std::runtime_error("Failed to parse glb json chunk: " + error.errorString().toStdString());
+            root = doc.object();
+            has_json = true;
+        }
+        else if (chunk.type == GLB_CHUNK_BIN && !bin_chunk) {
+            bin_chunk = data + offset;
+            bin_chunk_size = chunk.length;
+        }
+
+        offset += alignUp(chunk.length, 4);
+    }
+
+    if (!has_json)
+        throw std::runtime_error("Invalid glb file: Missing json chunk");
+
+    loadBuffers(bin_chunk, bin_chunk_size);
+}
+
+void GltfDocument::loadBuffers(const char* glb_bin_chunk, size_t glb_bin_chunk_size) {
+    const auto json_buffers = root.value("buffers").toArray();
+    for (int i = 0; i < json_buffers.size(); ++i) {
+        const auto json_buffer = json_buffers[i].toObject();
+        const auto byte_length = static_cast<size_t>(json_buffer.value("byteLength").toDouble());
+
+        Buffer buffer;
+        if (!json_buffer.contains("uri")) {
+            //Only the first buffer of a glb may reference the binary chunk.
+            if (i != 0 || !glb_bin_chunk)
+                throw std::runtime_error("glTF buffer without uri");
+            buffer.data = glb_bin_chunk;
+            buffer.size = glb_bin_chunk_size;
+        }
+        else {
+            const auto uri = json_buffer.value("uri").toString();
+            if (uri.startsWith("data:")) {
+                const auto base64_start = uri.indexOf(";base64,");
+                if (base64_start == -1)
+                    throw std::runtime_error("Unsupported glTF data uri");
+                auto decoded = QByteArray::fromBase64(uri.mid(base64_start + 8).toLatin1());
+                buffer.owned.assign(decoded.cbegin(), decoded.cend());
+                buffer.data = buffer.owned.data();
+                buffer.size = buffer.owned.size();
+            }
+            else {
+                const auto decoded_uri = QUrl::fromPercentEncoding(uri.toUtf8()).toStdString();
+                buffer.source = path.parent_path() / std::filesystem::u8path(decoded_uri);
+                buffer.data = mapFile(buffer.source, buffer.size);
+            }
+        }
+
+        if (buffer.size < byte_length)
+            throw std::runtime_error("glTF buffer " + std::to_string(i) + " is smaller than its byteLength");
+        buffer.size = byte_length;
+
+        buffers.push_back(std::move(buffer));
+    }
+}
+
+std::vector<GltfPrimitiveRef> GltfDocument::primitives() const {
+    std::vector<GltfPrimitiveRef> refs;
+
+    const auto meshes = array("meshes");
+    for (int m = 0; m < meshes.size(); ++m) {
+        const auto mesh = meshes[m].toObject();
+        const auto mesh_primitives = mesh.value("primitives").toArray();
+        for (int p = 0; p < mesh_primitives.size(); ++p) {
+            GltfPrimitiveRef ref;
+            ref.mesh = m;
+            ref.primitive = p;
+            ref.mesh_name = mesh.value("name").toString().toStdString();
+            ref.json = mesh_primitives[p].toObject();
+            refs.push_back(std::move(ref));
+        }
+    }
+
+    return refs;
+}
+
+void GltfDocument::setPrimitive(const GltfPrimitiveRef& primitive) {
+    auto& meshes = editArray("meshes");
+    auto mesh = meshes.at(primitive.mesh).toObject();
+    auto mesh_primitives = mesh.value("primitives").toArray();
+    mesh_primitives[primitive.primitive] = primitive.json;
+    mesh["primitives"] = mesh_primitives;
+    meshes[primitive.mesh] = mesh;
+}
+
+GltfAccessorUseCounts GltfDocument::accessorUseCounts() const {
+    GltfAccessorUseCounts use_counts;
+    auto& counts = use_counts.counts;
+    counts.resize(array("accessors").size(), 0);
+    auto count = [&counts](const QJsonValue& value) {
+        const auto accessor = value.toInt(-1);
+        if (accessor >= 0 && accessor < static_cast<int>(counts.size()))
+            ++counts[accessor];
+    };
+    auto countAttributes = [&count](const QJsonObject& attributes) {
+        for (auto it = attributes.begin(); it != attributes.end(); ++it)
+            count(it.value());
+    };
+
+    for (const auto& mesh : array("meshes")) {
+        for (const auto& primitive : mesh.toObject().value("primitives").toArray()) {
+            const auto json = primitive.toObject();
+            count(json.value("indices"));
+            countAttributes(json.value("attributes").toObject());
+            for (const auto& target : json.value("targets").toArray())
+                countAttributes(target.toObject());
+        }
+    }
+    return use_counts;
+}
+
+size_t GltfDocument::accessorCount(int accessor) const {
+    return static_cast<size_t>(array("accessors").at(accessor).toObject().value("count").toDouble());
+}
+
+int GltfDocument::accessorComponents(int accessor) const {
+    return gltfTypeComponents(array("accessors").at(accessor).toObject().value("type").toString());
+}
+
+GltfComponentType GltfDocument::accessorComponentType(int accessor) const {
+    return static_cast<GltfComponentType>(array("accessors").at(accessor).toObject().value("componentType").toInt());
+}
+
+bool GltfDocument::accessorNormalized(int accessor) const {
+    return array("accessors").at(accessor).toObject().value("normalized").toBool();
+}
+
+const char* GltfDocument::viewData(const QJsonObject& view, size_t& size) const {
+    const auto buffer = view.value("buffer").toInt();
+    const auto offset = static_cast<size_t>(view.value("byteOffset").toDouble());
+    size = static_cast<size_t>(view.value("byteLength").toDouble());
+    if (buffer < 0 || buffer >= buffers.size() || offset + size > buffers[buffer].size)
+        throw std::runtime_error("glTF buffer view out of bounds");
+    return buffers[buffer].data + offset;
+}
+
+namespace {
+    float readComponent(const char* src, GltfComponentType type, bool normalized) {
+        switch (type) {
+        case GltfComponentType::FLOAT: {
+            float v;
+            memcpy(&v, src, sizeof(v));
+            return v;
+        }
+        case GltfComponentType::BYTE: {
+            const auto v = *reinterpret_cast<const int8_t*>(src);
+            return normalized ? std::max(v / 127.0f, -1.0f) : v;
+        }
+        case GltfComponentType::UNSIGNED_BYTE: {
+            const auto v = *reinterpret_cast<const uint8_t*>(src);
+            return normalized ? v / 255.0f : v;
+        }
+        case GltfComponentType::SHORT: {
+            int16_t v;
+            memcpy(&v, src, sizeof(v));
+            return normalized ? std::max(v / 32767.0f, -1.0f) : v;
+        }
+        case GltfComponentType::UNSIGNED_SHORT: {
+            uint16_t v;
+            memcpy(&v, src, sizeof(v));
+            return normalized ? v / 65535.0f : v;
+        }
+        case GltfComponentType::UNSIGNED_INT: {
+            uint32_t v;
+            memcpy(&v, src, sizeof(v));
+            return static_cast<float>(v);
+        }
+        default:
+            throw std::runtime_error("Unsupported glTF component type");
+        }
+    }
+
+    uint32_t readIndex(const char* src, GltfComponentType type) {
+        switch (type) {
+        case GltfComponentType::UNSIGNED_BYTE:
+            return *reinterpret_cast<const uint8_t*>(src);
+        case GltfComponentType::UNSIGNED_SHORT: {
+            uint16_t v;
+            memcpy(&v, src, sizeof(v));
+            return v;
+        }
+        case GltfComponentType::UNSIGNED_INT: {
+            uint32_t v;
+            memcpy(&v, src, sizeof(v));
+            return v;
+        }
+        default:
+            throw std::runtime_error("Unsupported glTF index component type");
+        }
+    }
+}
+
+std::vector<float> GltfDocument::readAccessor(int accessor) const {
+    const auto json_accessor = array("accessors").at(accessor).toObject();
+    const auto count = static_cast<size_t>(json_accessor.value("count").toDouble());
+    const auto components = gltfTypeComponents(json_accessor.value("type").toString());
+    const auto component_type = static_cast<GltfComponentType>(json_accessor.value("componentType").toInt());
+    const auto normalized = json_accessor.value("normalized").toBool();
+    const auto component_size = gltfComponentSize(component_type);
+    const auto element_size = component_size * components;
+
+    std::vector<float> values(count * components, 0.0f);
+
+    if (json_accessor.contains("bufferView")) {
+        const auto view = array("bufferViews").at(json_accessor.value("bufferView").toInt()).toObject();
+        size_t view_size = 0;
+        const char* view_data = viewData(view, view_size);
+        const auto offset = static_cast<size_t>(json_accessor.value("byteOffset").toDouble());
+        const auto stride = view.contains("byteStride") ? static_cast<size_t>(view.value("byteStride").toInt()) : element_size;
+        if (count && offset + stride * (count - 1) + element_size > view_size)
+            throw std::runtime_error("glTF accessor " + std::to_string(accessor) + " out of bounds");
+
+        if (component_type == GltfComponentType::FLOAT && stride == element_size) {
+            memcpy(values.data(), view_data + offset, count * element_size);
+        }
+        else {
+            for (size_t i = 0; i < count; ++i) {
+                const char* element = view_data + offset + i * stride;
+                for (int j = 0; j < components; ++j)
+                    values[i * components + j] = readComponent(element + j * component_size, component_type, normalized);
+            }
+        }
+    }
+
+    if (json_accessor.contains("sparse")) {
+        const auto sparse = json_accessor.value("sparse").toObject();
+        const auto sparse_count = static_cast<size_t>(sparse.value("count").toDouble());
+        const auto indices = sparse.value("indices").toObject();
+        const auto sparse_values = sparse.value("values").toObject();
+        const auto index_type = static_cast<GltfComponentType>(indices.value("componentType").toInt());
+
+        const auto bufferViews = array("bufferViews");
+        size_t index_view_size = 0, value_view_size = 0;
+        const char* index_data = viewData(bufferViews.at(indices.value("bufferView").toInt()).toObject(), index_view_size);
+        const char* value_data = viewData(bufferViews.at(sparse_values.value("bufferView").toInt()).toObject(), value_view_size);
+        const auto index_offset = static_cast<size_t>(indices.value("byteOffset").toDouble());
+        const auto value_offset = static_cast<size_t>(sparse_values.value("byteOffset").toDouble());
+        const auto index_size = gltfComponentSize(index_type);
+        if (index_offset > index_view_size || sparse_count > (index_view_size - index_offset) / index_size)
+            throw std::runtime_error("glTF sparse accessor " + std::to_string(accessor) + " indices out of bounds");
+        if (value_offset > value_view_size || sparse_count > (value_view_size - value_offset) / element_size)
+            throw std::runtime_error("glTF sparse accessor " + std::to_string(accessor) + " values out of bounds");
+        index_data += index_offset;
+        value_data += value_offset;
+
+        for (size_t i = 0; i < sparse_count; ++i) {
+            const auto index = readIndex(index_data + i * index_size, index_type);
+            if (index >= count)
+                throw std::runtime_error("glTF sparse accessor index out of bounds");
+            for (int j = 0; j < components; ++j)
+                values[index * components + j] = readComponent(value_data + i * element_size + j * component_size, component_type, normalized);
+        }
+    }
+
+    return values;
+}
+
+std::vector<char> GltfDocument::readAccessorElements(int accessor) const {
+    const auto json_accessor = array("accessors").at(accessor).toObject();
+    if (json_accessor.contains("sparse"))
+        throw std::runtime_error("Sparse glTF accessors are not supported");
+
+    const auto count = static_cast<size_t>(json_accessor.value("count").toDouble());
+    const auto components = gltfTypeComponents(json_accessor.value("type").toString());
+    const auto component_type = static_cast<GltfComponentType>(json_accessor.value("componentType").toInt());
+    const auto element_size = gltfComponentSize(component_type) * components;
+
+    std::vector<char> elements(count * element_size, 0);
+    if (!json_accessor.contains("bufferView"))
+        return elements;
+
+    const auto view = array("bufferViews").at(json_accessor.value("bufferView").toInt()).toObject();
+    size_t view_size = 0;
+    const char* view_data = viewData(view, view_size);
+    const auto offset = static_cast<size_t>(json_accessor.value("byteOffset").toDouble());
+    const auto stride = view.contains("byteStride") ? static_cast<size_t>(view.value("byteStride").toInt()) : element_size;
+    if (count && offset + stride * (count - 1) + element_size > view_size)
+        throw std::runtime_error("glTF accessor " + std::to_string(accessor) + " out of bounds");
+
+    if (stride == element_size) {
+        memcpy(elements.data(), view_data + offset, elements.size());
+    }
+    else {
+        for (size_t i = 0; i < count; ++i)
+            memcpy(elements.data() + i * element_size, view_data + offset + i * stride, element_size);
+    }
+
+    return elements;
+}
+
+std::vector<uint32_t> GltfDocument::readIndices(int accessor) const {
+    const auto json_accessor = array("accessors").at(accessor).toObject();
+    const auto count = static_cast<size_t>(json_accessor.value("count").toDouble());
+    const auto component_type = static_cast<GltfComponentType>(json_accessor.value("componentType").toInt());
+    const auto component_size = gltfComponentSize(component_type);
+
+    std::vector<uint32_t> indices(count);
+    if (!json_accessor.contains("bufferView"))
+        return indices;
+
+    const auto view = array("bufferViews").at(json_accessor.value("bufferView").toInt()).toObject();
+    size_t view_size = 0;
+    const char* view_data = viewData(view, view_size);
+    const auto offset = static_cast<size_t>(json_accessor.value("byteOffset").toDouble());
+    const auto stride = view.contains("byteStride") ? static_cast<size_t>(view.value("byteStride").toInt()) : component_size;
+    if (count && offset + stride * (count - 1) + component_size > view_size)
+        throw std::runtime_error("glTF accessor " + std::to_string(accessor) + " out of bounds");
+
+    for (size_t i = 0; i < count; ++i)
+        indices[i] = readIndex(view_data + offset + i * stride, component_type);
+
+    return indices;
+}
+
+int GltfDocument::appendBufferView(const void* data, size_t element_size, size_t count, GltfBufferTarget target) {
+    if (ownedBuffer == -1) {
+        ownedBuffer = static_cast<int>(buffers.size());
+        buffers.emplace_back();
+
+        QJsonObject json_buffer;
+        json_buffer["byteLength"] = 0;
+        editArray("buffers").append(json_buffer);
+    }
+
+    //Vertex attribute elements have to start on 4 byte boundaries.
+    size_t stride = element_size;
+    if (target == GltfBufferTarget::ARRAY_BUFFER)
+        stride = alignUp(element_size, 4);
+
+    auto& buffer = buffers[ownedBuffer];
+    const auto offset = alignUp(buffer.owned.size(), 4);
+    const auto size = stride * count;
+    buffer.owned.resize(offset + size);
+    if (stride == element_size) {
+        memcpy(buffer.owned.data() + offset, data, size);
+    }
+    else {
+        for (size_t i = 0; i < count; ++i)
+            memcpy(buffer.owned.data() + offset + i * stride, reinterpret_cast<const char*>(data) + i * element_size, element_size);
+    }
+    buffer.data = buffer.owned.data();
+    buffer.size = buffer.owned.size();
+
+    QJsonObject view;
+    view["buffer"] = ownedBuffer;
+    view["byteOffset"] = static_cast<double>(offset);
+    view["byteLength"] = static_cast<double>(size);
+    if (stride != element_size)
+        view["byteStride"] = static_cast<int>(stride);
+    if (target != GltfBufferTarget::NONE)
+        view["target"] = static_cast<int>(target);
+
+    auto& views = editArray("bufferViews");
+    views.append(view);
+    return views.size() - 1;
+}
+
+int GltfDocument::copyBufferView(const GltfDocument& other, int view) {
+    const auto other_view = other.array("bufferViews").at(view).toObject();
+    size_t size = 0;
+    const char* data = other.viewData(other_view, size);
+
+    const auto new_view = appendBufferView(data, 1, size, GltfBufferTarget::NONE);
+
+    if (other_view.contains("byteStride") || other_view.contains("target")) {
+        auto& views = editArray("bufferViews");
+        auto json_view = views.at(new_view).toObject();
+        if (other_view.contains("byteStride"))
+            json_view["byteStride"] = other_view.value("byteStride");
+        if (other_view.contains("target"))
+            json_view["target"] = other_view.value("target");
+        views[new_view] = json_view;
+    }
+
+    return new_view;
+}
+
+QJsonObject GltfDocument::accessorJson(const void* data, size_t count, GltfComponentType component_type, int components, bool normalized, GltfBufferTarget target) {
+    const auto element_size = gltfComponentSize(component_type) * components;
+
+    QJsonObject json_accessor;
+    json_accessor["bufferView"] = appendBufferView(data, element_size, count, target);
+    json_accessor["componentType"] = static_cast<int>(component_type);
+    json_accessor["count"] = static_cast<double>(count);
+    json_accessor["type"] = gltfComponentsType(components);
+    if (normalized)
+        json_accessor["normalized"] = true;
+
+    //min/max are mandatory for positions, float accessors get them unconditionally.
+    if (component_type == GltfComponentType::FLOAT && count) {
+        const auto values = reinterpret_cast<const float*>(data);
+        std::vector<float> min(values, values + components);
+        std::vector<float> max(values, values + components);
+        for (size_t i = 1; i < count; ++i) {
+            for (int j = 0; j < components; ++j) {
+                min[j] = std::min(min[j], values[i * components + j]);
+                max[j] = std::max(max[j], values[i * components + j]);
+            }
+        }
+        QJsonArray json_min, json_max;
+        for (int j = 0; j < components; ++j) {
+            json_min.append(min[j]);
+            json_max.append(max[j]);
+        }
+        json_accessor["min"] = json_min;
+        json_accessor["max"] = json_max;
+    }
+
+    return json_accessor;
+}
+
+void GltfDocument::replaceAccessor(int accessor, const void* data, size_t count, GltfComponentType component_type, int components, bool normalized, GltfBufferTarget target) {
+    auto json_accessor = accessorJson(data, count, component_type, components, normalized, target);
+
+    auto& accessors = editArray("accessors");
+    const auto old_name = accessors.at(accessor).toObject().value("name");
+    if (!old_name.isUndefined())
+        json_accessor["name"] = old_name;
+    accessors[accessor] = json_accessor;
+}
+
+int GltfDocument::appendAccessor(const void* data, size_t count, GltfComponentType component_type, int components, bool normalized, GltfBufferTarget target) {
+    auto json_accessor = accessorJson(data, count, component_type, components, normalized, target);
+
+    auto& accessors = editArray("accessors");
+    accessors.append(json_accessor);
+    return accessors.size() - 1;
+}
+
+void GltfDocument::compact() {
+    TraceSpan span("Compact glTF buffers", "kernel");
+    writeBackArrays();
+    auto views = array("bufferViews");
+    auto accessors = array("accessors");
+    auto images = root.value("images").toArray();
+
+    std::vector<int> view_remap(views.size(), -1);
+    auto markView = [&view_remap](const QJsonValue& view) {
+        if (view.isDouble() && view.toInt() >= 0 && view.toInt() < view_remap.size())
+            view_remap[view.toInt()] = 0;
+    };
+    for (const auto& accessor : accessors) {
+        const auto json_accessor = accessor.toObject();
+        markView(json_accessor.value("bufferView"));
+        const auto sparse = json_accessor.value("sparse").toObject();
+        markView(sparse.value("indices").toObject().value("bufferView"));
+        markView(sparse.value("values").toObject().value("bufferView"));
+    }
+    for (const auto& image : images)
+        markView(image.toObject().value("bufferView"));
+
+    //Copy referenced views into a new buffer
+    Buffer compacted;
+    QJsonArray new_views;
+    for (int i = 0; i < views.size(); ++i) {
+        if (view_remap[i] == -1)
+            continue;
+
+        auto view = views[i].toObject();
+        size_t size = 0;
+        const char* data = viewData(view, size);
+
+        const auto offset = alignUp(compacted.owned.size(), GLB_BIN_ALIGNMENT);
+        compacted.owned.resize(offset + size);
+        memcpy(compacted.owned.data() + offset, data, size);
+
+        view["buffer"] = 0;
+        view["byteOffset"] = static_cast<double>(offset);
+        view_remap[i] = new_views.size();
+        new_views.append(view);
+    }
+    compacted.data = compacted.owned.data();
+    compacted.size = compacted.owned.size();
+
+    auto remapView = [&view_remap](QJsonObject& object) {
+        if (object.contains("bufferView"))
+            object["bufferView"] = view_remap.at(object.value("bufferView").toInt());
+    };
+    for (int i = 0; i < accessors.size(); ++i) {
+        auto json_accessor = accessors[i].toObject();
+        remapView(json_accessor);
+        if (json_accessor.contains("sparse")) {
+            auto sparse = json_accessor.value("sparse").toObject();
+            auto indices = sparse.value("indices").toObject();
+            auto values = sparse.value("values").toObject();
+            remapView(indices);
+            remapView(values);
+            sparse["indices"] = indices;
+            sparse["values"] = values;
+            json_accessor["sparse"] = sparse;
+        }
+        accessors[i] = json_accessor;
+    }
+    for (int i = 0; i < images.size(); ++i) {
+        auto image = images[i].toObject();
+        remapView(image);
+        images[i] = image;
+    }
+
+    if (accessors.size())
+        root["accessors"] = accessors;
+    if (images.size())
+        root["images"] = images;
+    root["bufferViews"] = new_views;
+
+    QJsonObject json_buffer;
+    json_buffer["byteLength"] = static_cast<double>(compacted.size);
+    root["buffers"] = QJsonArray{ json_buffer };
+
+    buffers.clear();
+    buffers.push_back(std::move(compacted));
+    ownedBuffer = 0;
+}
+
+QJsonObject GltfDocument::mergedBufferJson(std::vector<size_t>& buffer_offsets, size_t& bin_size) const {
+    writeBackArrays();
+    auto json = root;
+
+    //Place all buffers back to back in a single binary blob and redirect the buffer views.
+    buffer_offsets.resize(buffers.size());
+    bin_size = 0;
+    for (int i = 0; i < buffers.size(); ++i) {
+        bin_size = alignUp(bin_size, GLB_BIN_ALIGNMENT);
+        buffer_offsets[i] = bin_size;
+        bin_size += buffers[i].size;
+    }
+    bin_size = alignUp(bin_size, 4);
+
+    QJsonArray buffer_views = json.value("bufferViews").toArray();
+    for (int i = 0; i < buffer_views.size(); ++i) {
+        auto view = buffer_views[i].toObject();
+        const auto buffer = view.value("buffer").toInt();
+        view["buffer"] = 0;
+        view["byteOffset"] = static_cast<double>(buffer_offsets.at(buffer) + view.value("byteOffset").toDouble());
+        buffer_views[i] = view;
+    }
+    if (buffer_views.size())
+        json["bufferViews"] = buffer_views;
+
+    if (buffers.size()) {
+        QJsonObject bin_buffer;
+        bin_buffer["byteLength"] = static_cast<double>(bin_size);
+        json["buffers"] = QJsonArray{ bin_buffer };
+    }
+    else {
+        json.remove("buffers");
+    }
+
+    return json;
+}
+
+//Writes the buffers at their merged offsets, padding the gaps with zeros.
+void GltfDocument::writeMergedBuffers(std::ostream& out, const std::vector<size_t>& buffer_offsets, size_t bin_size) const {
+    const char padding[GLB_BIN_ALIGNMENT]{};
+    size_t written = 0;
+    for (int i = 0; i < buffers.size(); ++i) {
+        out.write(padding, buffer_offsets[i] - written);
+        out.write(buffers[i].data, buffers[i].size);
+        written = buffer_offsets[i] + buffers[i].size;
+    }
+    out.write(padding, bin_size - written);
+}
+
+void GltfDocument::saveGltf(const std::filesystem::path& gltf_path) const {
+    TraceSpan span("Save glTF", "io");
+    std::vector<size_t> buffer_offsets;
+    size_t bin_size = 0;
+    auto json = mergedBufferJson(buffer_offsets, bin_size);
+    span.setBytes(bin_size);
+
+    if (buffers.size()) {
+        const auto bin_name = gltf_path.stem().generic_string() + ".bin";
+
+        std::ofstream bin(gltf_path.parent_path() / bin_name, std::ios::binary);
+        if (!bin)
+            throw std::runtime_error("Failed to open " + bin_name + " for writing");
+        writeMergedBuffers(bin, buffer_offsets, bin_size);
+        if (!bin)
+            throw std::runtime_error("Failed to write " + bin_name);
+
+        auto json_buffers = json.value("buffers").toArray();
+        auto json_buffer = json_buffers[0].toObject();
+        json_buffer["uri"] = QString::fromStdString(bin_name);
+        json_buffers[0] = json_buffer;
+        json["buffers"] = json_buffers;
+    }
+
+    QFile file(QString::fromStdString(gltf_path.generic_string()));
+    if (!file.open(QIODevice::WriteOnly))
+        throw std::runtime_error("Failed to open " + gltf_path.generic_string() + " for writing");
+    file.write(QJsonDocument(json).toJson(QJsonDocument::Compact));
+}
+
+void GltfDocument::saveGlb(const std::filesystem::path& glb_path) const {
+    TraceSpan span("Save glb", "io");
+    std::vector<size_t> buffer_offsets;
+    size_t bin_size = 0;
+    auto json = mergedBufferJson(buffer_offsets, bin_size);
+    span.setBytes(bin_size);
+
+    auto json_data = QJsonDocument(json).toJson(QJsonDocument::Compact);
+    //Pad json chunk such that the binary chunk payload starts on an aligned file offset.
+    const size_t bin_payload_offset = sizeof(GlbHeader) + 2 * sizeof(GlbChunkHeader);
+    while ((bin_payload_offset + json_data.size()) % GLB_BIN_ALIGNMENT)
+        json_data.append(' ');
+
+    GlbHeader header{ GLB_MAGIC, GLB_VERSION, 0 };
+    header.length = static_cast<uint32_t>(sizeof(GlbHeader) + sizeof(GlbChunkHeader) + json_data.size());
+    if (buffers.size())
+        header.length += static_cast<uint32_t>(sizeof(GlbChunkHeader) + bin_size);
+
+    std::ofstream glb(glb_path, std::ios::binary);
+    if (!glb)
+        throw std::runtime_error("Failed to open " + glb_path.generic_string() + " for writing");
+
+    glb.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    GlbChunkHeader json_chunk{ static_cast<uint32_t>(json_data.size()), GLB_CHUNK_JSON };
+    glb.write(reinterpret_cast<const char*>(&json_chunk), sizeof(json_chunk));
+    glb.write(json_data.constData(), json_data.size());
+
+    if (buffers.size()) {
+        GlbChunkHeader bin_chunk{ static_cast<uint32_t>(bin_size), GLB_CHUNK_BIN };
+        glb.write(reinterpret_cast<const char*>(&bin_chunk), sizeof(bin_chunk));
+        writeMergedBuffers(glb, buffer_offsets, bin_size);
+    }
+
+    if (!glb)
+        throw std::runtime_error("Failed to write " + glb_path.generic_string());
+}
+
+bool isGlbFile(const std::filesystem::path& path) {
+    auto extension = path.extension().generic_string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(::tolower(c)); });
+    return extension == ".glb";
+}
+
+size_t gltfComponentSize(GltfComponentType type) {
+    switch (type) {
+    case GltfComponentType::BYTE:
+    case GltfComponentType::UNSIGNED_BYTE:
+        return 1;
+    case GltfComponentType::SHORT:
+    case GltfComponentType::UNSIGNED_SHORT:
+        return 2;
+    case GltfComponentType::UNSIGNED_INT:
+    case GltfComponentType::FLOAT:
+        return 4;
+    default:
+        throw std::runtime_error("Unsupported glTF component type");
+    }
+}
+
+int gltfTypeComponents(const QString& type) {
+    if (type == "SCALAR")
+        return 1;
+    if (type == "VEC2")
+        return 2;
+    if (type == "VEC3")
+        return 3;
+    if (type == "VEC4" || type == "MAT2")
+        return 4;
+    if (type == "MAT3")
+        return 9;
+    if (type == "MAT4")
+        return 16;
+    throw std::runtime_error("Unsupported glTF accessor type " + type.toStdString());
+}
+
+QString gltfComponentsType(int components) {
+    switch (components) {
+    case 1:
+        return "SCALAR";
+    case 2:
+        return "VEC2";
+    case 3:
+        return "VEC3";
+    case 4:
+        return "VEC4";
+    case 16:
+        return "MAT4";
+    default:
+        throw std::runtime_error("Unsupported glTF component count");
+    }
+}
+
+void forEachGltfTextureInfo(QJsonObject& material, const std::function<void(QJsonObject&)>& visit) {
+    for (auto it = material.begin(); it != material.end(); ++it) {
+        if (!it.value().isObject())
+            continue;
+        auto child = it.value().toObject();
+        if (child.contains("index") && it.key().endsWith("Texture"))
+            visit(child);
+        else
+            forEachGltfTextureInfo(child, visit);
+        it.value() = child;
+    }
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <QJsonArray>
+#include <QJsonObject>
+
+#include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class QFile;
+
+enum class GltfComponentType : int {
+    BYTE = 5120,
+    UNSIGNED_BYTE = 5121,
+    SHORT = 5122,
+    UNSIGNED_SHORT = 5123,
+    UNSIGNED_INT = 5125,
+    FLOAT = 5126
+};
+
+enum class GltfBufferTarget : int {
+    NONE = 0,
+    ARRAY_BUFFER = 34962,
+    ELEMENT_ARRAY_BUFFER = 34963
+};
+
+size_t gltfComponentSize(GltfComponentType type);
+int gltfTypeComponents(const QString& type);
+QString gltfComponentsType(int components);
+
+//A mesh primitive with a copy of its json, changes are written back with GltfDocument::setPrimitive.
+struct GltfPrimitiveRef {
+    int mesh = -1;
+    int primitive = -1;
+    std::string mesh_name;
+    QJsonObject json;
+};
+
+//Number of references to each accessor from mesh primitives, including indices and morph targets.
+struct GltfAccessorUseCounts {
+    std::vector<int> counts;
+
+    int operator[](int accessor) const {
+        return accessor >= 0 && accessor < static_cast<int>(counts.size()) ? counts[accessor] : 0;
+    }
+};
+
+//Light weight view of a glTF 2.0 file. Supports .gltf files with external or data uri buffers as well as binary .glb containers.
+//Buffers are memory mapped from disk and are only copied when the document is written out again.
+class GltfDocument {
+public:
+    explicit GltfDocument(const std::filesystem::path& path);
+    ~GltfDocument();
+
+    //Pending edits of the functions below are written back first. Edits made through them afterwards only show up in
+    //the returned object with the next call.
+    QJsonObject& json();
+    const QJsonObject& json() const;
+
+    int bufferCount() const;
+    const char* bufferData(int buffer) const;
+    size_t bufferSize(int buffer) const;
+
+    //All primitives of all meshes in document order.
+    std::vector<GltfPrimitiveRef> primitives() const;
+    void setPrimitive(const GltfPrimitiveRef& primitive);
+    //Use counts of all accessors in a single walk over the primitives. Passes take them once up front, edits only replace
+    //accessors or add new ones, so a count can get stale only towards treating an accessor as shared.
+    GltfAccessorUseCounts accessorUseCounts() const;
+
+    size_t accessorCount(int accessor) const;
+    int accessorComponents(int accessor) const;
+    GltfComponentType accessorComponentType(int accessor) const;
+    bool accessorNormalized(int accessor) const;
+
+    //Reads an accessor into a tightly packed float array. Normalized integer components are converted to their float range.
+    std::vector<float> readAccessor(int accessor) const;
+    //Reads the raw, tightly packed elements of a non-sparse accessor.
+    std::vector<char> readAccessorElements(int accessor) const;
+    //Reads an index accessor.
+    std::vector<uint32_t> readIndices(int accessor) const;
+
+    //Points an existing accessor at new, tightly packed element data. The data is stored in a document owned buffer,
+    //the previously referenced data stays in place until compact() is called.
+    void replaceAccessor(int accessor, const void* data, size_t count, GltfComponentType component_type, int components, bool normalized, GltfBufferTarget target);
+    //Same as replaceAccessor but creates a new accessor. Returns the index of the new accessor.
+    int appendAccessor(const void* data, size_t count, GltfComponentType component_type, int components, bool normalized, GltfBufferTarget target);
+
+    //Copies a buffer view of another document into a new view of this document, keeping stride and target.
+    //Returns the index of the new view.
+    int copyBufferView(const GltfDocument& other, int view);
+
+    //Drops all buffer data that isn't referenced by an accessor or image anymore and merges the rest into a single owned buffer.
+    void compact();
+
+    //Files that back the buffers of the document, not including the document file itself.
+    std::vector<std::filesystem::path> externalFiles() const;
+
+    //Writes the document as .gltf. All buffers are merged into a single <stem>.bin next to it, each buffer starting on a 16 byte boundary.
+    //Only used for staged and post-processed documents, the initial export of a PRIM is written by GLTFExporter.
+    void saveGltf(const std::filesystem::path& gltf_path) const;
+    //Writes the document as single .glb. All buffers are merged into the binary chunk.
+    void saveGlb(const std::filesystem::path& glb_path) const;
+
+private:
+    struct Buffer {
+        std::vector<char> owned;
+        const char* data = nullptr;
+        size_t size = 0;
+        std::filesystem::path source;
+    };
+
+    std::filesystem::path path;
+    //Top level arrays edited through the document functions are kept in editedArrays instead of root, so an edit doesn't
+    //copy the whole array. They are written back into root whenever the json is handed out or the document is saved.
+    mutable QJsonObject root;
+    mutable std::map<QString, QJsonArray> editedArrays;
+    std::vector<Buffer> buffers;
+    std::vector<std::unique_ptr<QFile>> mappedFiles;
+    int ownedBuffer = -1;
+
+    QJsonArray array(const QString& key) const;
+    QJsonArray& editArray(const QString& key);
+    void writeBackArrays() const;
+
+    const char* mapFile(const std::filesystem::path& file_path, size_t& size);
+    void loadGlb(const char* data, size_t size);
+    void loadBuffers(const char* glb_bin_chunk, size_t glb_bin_chunk_size);
+
+    QJsonObject accessorJson(const void* data, size_t count, GltfComponentType component_type, int components, bool normalized, GltfBufferTarget target);
+    int appendBufferView(const void* data, size_t element_size, size_t count, GltfBufferTarget target);
+    const char* viewData(const QJsonObject& view, size_t& size) const;
+
+    QJsonObject mergedBufferJson(std::vector<size_t>& buffer_offsets, size_t& bin_size) const;
+    void writeMergedBuffers(std::ostream& out, const std::vector<size_t>& buffer_offsets, size_t bin_size) const;
+};
+
+bool isGlbFile(const std::filesystem::path& path);
+
+//Calls visit for every texture info object (baseColorTexture, normalTexture, ...) of a material, including those of extensions.
+void forEachGltfTextureInfo(QJsonObject& material, const std::function<void(QJsonObject&)>& visit);
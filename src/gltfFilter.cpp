@@ -0,0 +1,264 @@
+#include "gltfFilter.h"
+#include "trace.h"
+
+#include <QJsonArray>
+
+namespace {
+    //Removes the unmarked entries of a top level array and returns remap[old_index] = new_index, -1 for removed entries.
+    std::vector<int> removeUnused(QJsonObject& json, const QString& name, const std::vector<bool>& used) {
+        auto entries = json.value(name).toArray();
+        std::vector<int> remap(entries.size(), -1);
+
+        QJsonArray kept;
+        for (int i = 0; i < entries.size(); ++i) {
+            if (!used[i])
+                continue;
+            remap[i] = kept.size();
+            kept.append(entries[i]);
+        }
+
+        if (json.contains(name))
+            json[name] = kept;
+        return remap;
+    }
+
+    void remapIndex(QJsonObject& object, const QString& key, const std::vector<int>& remap) {
+        if (object.contains(key))
+            object[key] = remap[object.value(key).toInt()];
+    }
+
+    std::vector<int> pruneAccessors(QJsonObject& json) {
+        std::vector<bool> used(json.value("accessors").toArray().size(), false);
+        auto mark = [&used](const QJsonValue& accessor) {
+            if (accessor.isDouble())
+                used[accessor.toInt()] = true;
+        };
+
+        for (const auto& mesh : json.value("meshes").toArray()) {
+            for (const auto& primitive_value : mesh.toObject().value("primitives").toArray()) {
+                const auto primitive = primitive_value.toObject();
+                mark(primitive.value("indices"));
+                for (const auto& accessor : primitive.value("attributes").toObject())
+                    mark(accessor);
+                for (const auto& target : primitive.value("targets").toArray()) {
+                    for (const auto& accessor : target.toObject())
+                        mark(accessor);
+                }
+            }
+        }
+        for (const auto& skin : json.value("skins").toArray())
+            mark(skin.toObject().value("inverseBindMatrices"));
+        for (const auto& animation : json.value("animations").toArray()) {
+            for (const auto& sampler : animation.toObject().value("samplers").toArray()) {
+                mark(sampler.toObject().value("input"));
+                mark(sampler.toObject().value("output"));
+            }
+        }
+
+        auto remap = removeUnused(json, "accessors", used);
+
+        auto meshes = json.value("meshes").toArray();
+        for (int m = 0; m < meshes.size(); ++m) {
+            auto mesh = meshes[m].toObject();
+            auto primitives = mesh.value("primitives").toArray();
+            for (int p = 0; p < primitives.size(); ++p) {
+                auto primitive = primitives[p].toObject();
+                remapIndex(primitive, "indices", remap);
+
+                auto attributes = primitive.value("attributes").toObject();
+                for (auto it = attributes.begin(); it != attributes.end(); ++it)
+                    it.value() = remap[it.value().toInt()];
+                primitive["attributes"] = attributes;
+
+                if (primitive.contains("targets")) {
+                    auto targets = primitive.value("targets").toArray();
+                    for (int t = 0; t < targets.size(); ++t) {
+                        auto target = targets[t].toObject();
+                        for (auto it = target.begin(); it != target.end(); ++it)
+                            it.value() = remap[it.value().toInt()];
+                        targets[t] = target;
+                    }
+                    primitive["targets"] = targets;
+                }
+                primitives[p] = primitive;
+            }
+            mesh["primitives"] = primitives;
+            meshes[m] = mesh;
+        }
+        if (json.contains("meshes"))
+            json["meshes"] = meshes;
+
+        auto skins = json.value("skins").toArray();
+        for (int i = 0; i < skins.size(); ++i) {
+            auto skin = skins[i].toObject();
+            remapIndex(skin, "inverseBindMatrices", remap);
+            skins[i] = skin;
+        }
+        if (json.contains("skins"))
+            json["skins"] = skins;
+
+        auto animations = json.value("animations").toArray();
+        for (int a = 0; a < animations.size(); ++a) {
+            auto animation = animations[a].toObject();
+            auto samplers = animation.value("samplers").toArray();
+            for (int s = 0; s < samplers.size(); ++s) {
+                auto sampler = samplers[s].toObject();
+                remapIndex(sampler, "input", remap);
+                remapIndex(sampler, "output", remap);
+                samplers[s] = sampler;
+            }
+            animation["samplers"] = samplers;
+            animations[a] = animation;
+        }
+        if (json.contains("animations"))
+            json["animations"] = animations;
+
+        return remap;
+    }
+
+    std::vector<int> pruneMaterials(QJsonObject& json) {
+        std::vector<bool> used(json.value("materials").toArray().size(), false);
+        for (const auto& mesh : json.value("meshes").toArray()) {
+            for (const auto& primitive : mesh.toObject().value("primitives").toArray()) {
+                const auto material = primitive.toObject().value("material");
+                if (material.isDouble())
+                    used[material.toInt()] = true;
+            }
+        }
+
+        auto remap = removeUnused(json, "materials", used);
+
+        auto meshes = json.value("meshes").toArray();
+        for (int m = 0; m < meshes.size(); ++m) {
+            auto mesh = meshes[m].toObject();
+            auto primitives = mesh.value("primitives").toArray();
+            for (int p = 0; p < primitives.size(); ++p) {
+                auto primitive = primitives[p].toObject();
+                remapIndex(primitive, "material", remap);
+                primitives[p] = primitive;
+            }
+            mesh["primitives"] = primitives;
+            meshes[m] = mesh;
+        }
+        if (json.contains("meshes"))
+            json["meshes"] = meshes;
+
+        return remap;
+    }
+
+    std::vector<std::string> pruneTextures(QJsonObject& json) {
+        auto materials = json.value("materials").toArray();
+
+        std::vector<bool> used_textures(json.value("textures").toArray().size(), false);
+        for (int i = 0; i < materials.size(); ++i) {
+            auto material = materials[i].toObject();
+            forEachGltfTextureInfo(material, [&used_textures](QJsonObject& info) { used_textures[info.value("index").toInt()] = true; });
+        }
+        const auto texture_remap = removeUnused(json, "textures", used_textures);
+        for (int i = 0; i < materials.size(); ++i) {
+            auto material = materials[i].toObject();
+            forEachGltfTextureInfo(material, [&texture_remap](QJsonObject& info) { remapIndex(info, "index", texture_remap); });
+            materials[i] = material;
+        }
+        if (json.contains("materials"))
+            json["materials"] = materials;
+
+        auto textures = json.value("textures").toArray();
+        const auto images = json.value("images").toArray();
+        std::vector<bool> used_images(images.size(), false);
+        for (const auto& texture : textures) {
+            const auto source = texture.toObject().value("source");
+            if (source.isDouble())
+                used_images[source.toInt()] = true;
+        }
+
+        std::vector<std::string> removed_images;
+        for (int i = 0; i < images.size(); ++i) {
+            const auto uri = images[i].toObject().value("uri").toString();
+            if (!used_images[i] && !uri.isEmpty() && !uri.startsWith("data:"))
+                removed_images.push_back(uri.toStdString());
+        }
+
+        const auto image_remap = removeUnused(json, "images", used_images);
+        for (int i = 0; i < textures.size(); ++i) {
+            auto texture = textures[i].toObject();
+            remapIndex(texture, "source", image_remap);
+            textures[i] = texture;
+        }
+        if (json.contains("textures"))
+            json["textures"] = textures;
+
+        //Samplers are only referenced by textures
+        std::vector<bool> used_samplers(json.value("samplers").toArray().size(), false);
+        for (const auto& texture : textures) {
+            const auto sampler = texture.toObject().value("sampler");
+            if (sampler.isDouble())
+                used_samplers[sampler.toInt()] = true;
+        }
+        const auto sampler_remap = removeUnused(json, "samplers", used_samplers);
+        for (int i = 0; i < textures.size(); ++i) {
+            auto texture = textures[i].toObject();
+            remapIndex(texture, "sampler", sampler_remap);
+            textures[i] = texture;
+        }
+        if (json.contains("textures"))
+            json["textures"] = textures;
+
+        return removed_images;
+    }
+}
+
+GltfFilterReport filterGltfMeshes(GltfDocument& document, const std::function<bool(const std::string& mesh_name)>& keep) {
+    TraceSpan span("Filter meshes", "kernel");
+    GltfFilterReport report;
+    auto& json = document.json();
+
+    const auto meshes = json.value("meshes").toArray();
+    std::vector<bool> kept(meshes.size(), false);
+    for (int i = 0; i < meshes.size(); ++i)
+        kept[i] = keep(meshes[i].toObject().value("name").toString().toStdString());
+
+    const auto mesh_remap = removeUnused(json, "meshes", kept);
+    for (const auto new_index : mesh_remap) {
+        if (new_index == -1)
+            ++report.meshes_removed;
+    }
+    if (report.meshes_removed == 0)
+        return report;
+
+    auto nodes = json.value("nodes").toArray();
+    for (int i = 0; i < nodes.size(); ++i) {
+        auto node = nodes[i].toObject();
+        if (!node.contains("mesh"))
+            continue;
+
+        const auto mesh = mesh_remap[node.value("mesh").toInt()];
+        if (mesh == -1) {
+            node.remove("mesh");
+            node.remove("skin");
+            node.remove("weights");
+        }
+        else {
+            node["mesh"] = mesh;
+        }
+        nodes[i] = node;
+    }
+    if (json.contains("nodes"))
+        json["nodes"] = nodes;
+
+    const auto accessor_remap = pruneAccessors(json);
+    for (const auto new_index : accessor_remap) {
+        if (new_index == -1)
+            ++report.accessors_removed;
+    }
+
+    const auto material_remap = pruneMaterials(json);
+    for (const auto new_index : material_remap) {
+        if (new_index == -1)
+            ++report.materials_removed;
+    }
+
+    report.removed_images = pruneTextures(json);
+
+    return report;
+}
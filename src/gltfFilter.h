@@ -0,0 +1,19 @@
+#pragma once
+#include "gltfDocument.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+struct GltfFilterReport {
+    int meshes_removed = 0;
+    int accessors_removed = 0;
+    int materials_removed = 0;
+    //Uris of images that aren't used by any of the remaining meshes anymore.
+    std::vector<std::string> removed_images;
+};
+
+//Removes all meshes for which keep returns false. Nodes instancing a removed mesh stay in the hierarchy but lose
+//their mesh and skin. Accessors, materials, textures, samplers and images that are no longer referenced get removed as well,
+//call compact() afterwards to drop the unused buffer data.
+GltfFilterReport filterGltfMeshes(GltfDocument& document, const std::function<bool(const std::string& mesh_name)>& keep);
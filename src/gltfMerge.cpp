@@ -0,0 +1,234 @@
+#include "gltfMerge.h"
+#include "trace.h"
+
+#include <QJsonArray>
+
+namespace {
+    //Index of the default scene, creating one with all nodes if the document has none.
+    int defaultScene(QJsonObject& json) {
+        auto scenes = json.value("scenes").toArray();
+        if (scenes.isEmpty()) {
+            QJsonArray nodes;
+            for (int i = 0; i < json.value("nodes").toArray().size(); ++i)
+                nodes.append(i);
+            QJsonObject scene;
+            scene["nodes"] = nodes;
+            scenes.append(scene);
+            json["scenes"] = scenes;
+        }
+        return json.value("scene").toInt(0);
+    }
+
+    //Appends the entries of source's array to target's array, remapping each with remap first. If deduplicate is set,
+    //entries equal to an existing one are shared. Returns remap[source_index] = target_index.
+    std::vector<int> appendEntries(QJsonObject& target, const QJsonObject& source, const QString& name, bool deduplicate,
+        const std::function<void(QJsonObject&)>& remap = {}) {
+        auto target_entries = target.value(name).toArray();
+        const auto source_entries = source.value(name).toArray();
+        std::vector<int> indices(source_entries.size(), -1);
+
+        for (int i = 0; i < source_entries.size(); ++i) {
+            auto entry = source_entries[i].toObject();
+            if (remap)
+                remap(entry);
+
+            if (deduplicate) {
+                for (int j = 0; j < target_entries.size() && indices[i] == -1; ++j) {
+                    if (target_entries[j].toObject() == entry)
+                        indices[i] = j;
+                }
+                if (indices[i] != -1)
+                    continue;
+            }
+
+            indices[i] = target_entries.size();
+            target_entries.append(entry);
+        }
+
+        if (!target_entries.isEmpty())
+            target[name] = target_entries;
+        return indices;
+    }
+
+    void remapIndex(QJsonObject& object, const QString& key, const std::vector<int>& remap) {
+        if (object.contains(key))
+            object[key] = remap.at(object.value(key).toInt());
+    }
+
+    void remapIndexObject(QJsonObject& object, const std::vector<int>& remap) {
+        for (auto it = object.begin(); it != object.end(); ++it)
+            it.value() = remap.at(it.value().toInt());
+    }
+
+    void mergeExtensions(QJsonObject& target, const QJsonObject& source, const QString& list) {
+        auto extensions = target.value(list).toArray();
+        for (const auto& extension : source.value(list).toArray()) {
+            if (!extensions.contains(extension))
+                extensions.append(extension);
+        }
+        if (!extensions.isEmpty())
+            target[list] = extensions;
+    }
+}
+
+void wrapGltfScene(GltfDocument& document, const QString& root_name) {
+    auto& json = document.json();
+    const auto scene_index = defaultScene(json);
+
+    auto scenes = json.value("scenes").toArray();
+    auto scene = scenes[scene_index].toObject();
+
+    auto nodes = json.value("nodes").toArray();
+    QJsonObject root;
+    root["name"] = root_name;
+    root["children"] = scene.value("nodes").toArray();
+    nodes.append(root);
+    json["nodes"] = nodes;
+
+    scene["nodes"] = QJsonArray{ nodes.size() - 1 };
+    scenes[scene_index] = scene;
+    json["scenes"] = scenes;
+}
+
+void appendGltfScene(GltfDocument& target, const GltfDocument& source, const QString& root_name) {
+    TraceSpan span("Append scene", "kernel");
+    const auto& source_json = source.json();
+
+    //Views get copied before the json is taken, so it includes them.
+    std::vector<int> views;
+    const auto source_view_count = source_json.value("bufferViews").toArray().size();
+    for (int i = 0; i < source_view_count; ++i)
+        views.push_back(target.copyBufferView(source, i));
+
+    auto& json = target.json();
+
+    const auto accessors = appendEntries(json, source_json, "accessors", false, [&views](QJsonObject& accessor) {
+        remapIndex(accessor, "bufferView", views);
+        if (accessor.contains("sparse")) {
+            auto sparse = accessor.value("sparse").toObject();
+            auto sparse_indices = sparse.value("indices").toObject();
+            auto sparse_values = sparse.value("values").toObject();
+            remapIndex(sparse_indices, "bufferView", views);
+            remapIndex(sparse_values, "bufferView", views);
+            sparse["indices"] = sparse_indices;
+            sparse["values"] = sparse_values;
+            accessor["sparse"] = sparse;
+        }
+    });
+
+    const auto samplers = appendEntries(json, source_json, "samplers", true);
+
+    //Images referencing the same file get shared, embedded images always end up in different views and get copied.
+    const auto images = appendEntries(json, source_json, "images", true, [&views](QJsonObject& image) {
+        remapIndex(image, "bufferView", views);
+    });
+
+    const auto textures = appendEntries(json, source_json, "textures", true, [&samplers, &images](QJsonObject& texture) {
+        remapIndex(texture, "sampler", samplers);
+        remapIndex(texture, "source", images);
+    });
+
+    const auto materials = appendEntries(json, source_json, "materials", true, [&textures](QJsonObject& material) {
+        forEachGltfTextureInfo(material, [&textures](QJsonObject& info) { remapIndex(info, "index", textures); });
+    });
+
+    const auto meshes = appendEntries(json, source_json, "meshes", false, [&accessors, &materials](QJsonObject& mesh) {
+        auto primitives = mesh.value("primitives").toArray();
+        for (int i = 0; i < primitives.size(); ++i) {
+            auto primitive = primitives[i].toObject();
+            remapIndex(primitive, "indices", accessors);
+            remapIndex(primitive, "material", materials);
+
+            auto attributes = primitive.value("attributes").toObject();
+            remapIndexObject(attributes, accessors);
+            primitive["attributes"] = attributes;
+
+            if (primitive.contains("targets")) {
+                auto targets = primitive.value("targets").toArray();
+                for (int t = 0; t < targets.size(); ++t) {
+                    auto morph_target = targets[t].toObject();
+                    remapIndexObject(morph_target, accessors);
+                    targets[t] = morph_target;
+                }
+                primitive["targets"] = targets;
+            }
+            primitives[i] = primitive;
+        }
+        mesh["primitives"] = primitives;
+    });
+
+    const auto cameras = appendEntries(json, source_json, "cameras", false);
+
+    const int node_offset = json.value("nodes").toArray().size();
+    auto offsetNode = [node_offset](QJsonValue node) { return node.toInt() + node_offset; };
+
+    const auto skins = appendEntries(json, source_json, "skins", false, [&accessors, &offsetNode](QJsonObject& skin) {
+        remapIndex(skin, "inverseBindMatrices", accessors);
+        if (skin.contains("skeleton"))
+            skin["skeleton"] = offsetNode(skin.value("skeleton"));
+        auto joints = skin.value("joints").toArray();
+        for (int i = 0; i < joints.size(); ++i)
+            joints[i] = offsetNode(joints[i]);
+        skin["joints"] = joints;
+    });
+
+    appendEntries(json, source_json, "nodes", false, [&meshes, &skins, &cameras, &offsetNode](QJsonObject& node) {
+        remapIndex(node, "mesh", meshes);
+        remapIndex(node, "skin", skins);
+        remapIndex(node, "camera", cameras);
+        if (node.contains("children")) {
+            auto children = node.value("children").toArray();
+            for (int i = 0; i < children.size(); ++i)
+                children[i] = offsetNode(children[i]);
+            node["children"] = children;
+        }
+    });
+
+    appendEntries(json, source_json, "animations", false, [&accessors, &offsetNode](QJsonObject& animation) {
+        auto samplers = animation.value("samplers").toArray();
+        for (int i = 0; i < samplers.size(); ++i) {
+            auto sampler = samplers[i].toObject();
+            remapIndex(sampler, "input", accessors);
+            remapIndex(sampler, "output", accessors);
+            samplers[i] = sampler;
+        }
+        animation["samplers"] = samplers;
+
+        auto channels = animation.value("channels").toArray();
+        for (int i = 0; i < channels.size(); ++i) {
+            auto channel = channels[i].toObject();
+            auto channel_target = channel.value("target").toObject();
+            if (channel_target.contains("node"))
+                channel_target["node"] = offsetNode(channel_target.value("node"));
+            channel["target"] = channel_target;
+            channels[i] = channel;
+        }
+        animation["channels"] = channels;
+    });
+
+    //Root node for the source scene
+    auto source_scene_json = source_json;
+    const auto source_scene = source_scene_json.value("scenes").toArray().at(defaultScene(source_scene_json)).toObject();
+    QJsonArray children;
+    for (const auto& node : source_scene.value("nodes").toArray())
+        children.append(offsetNode(node));
+
+    auto nodes = json.value("nodes").toArray();
+    QJsonObject root;
+    root["name"] = root_name;
+    root["children"] = children;
+    nodes.append(root);
+    json["nodes"] = nodes;
+
+    const auto scene_index = defaultScene(json);
+    auto scenes = json.value("scenes").toArray();
+    auto scene = scenes[scene_index].toObject();
+    auto scene_nodes = scene.value("nodes").toArray();
+    scene_nodes.append(nodes.size() - 1);
+    scene["nodes"] = scene_nodes;
+    scenes[scene_index] = scene;
+    json["scenes"] = scenes;
+
+    mergeExtensions(json, source_json, "extensionsUsed");
+    mergeExtensions(json, source_json, "extensionsRequired");
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include "gltfDocument.h"
+
+//Moves the root nodes of the default scene under a single new root node with the given name.
+void wrapGltfScene(GltfDocument& document, const QString& root_name);
+
+//Appends the content of source to target. The default scene of source ends up under a new root node with the given
+//name in the default scene of target. Buffer data gets copied into target's own buffer. Samplers, images with equal
+//uris, textures and materials that already exist in target are shared instead of duplicated.
+void appendGltfScene(GltfDocument& target, const GltfDocument& source, const QString& root_name);
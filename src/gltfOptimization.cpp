@@ -0,0 +1,721 @@
+#include "gltfOptimization.h"
+#include "meshNormals.h"
+#include "trace.h"
+
+#include <QJsonArray>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+
+namespace {
+    constexpr int GLTF_MODE_TRIANGLES = 4;
+
+    struct VertexAttribute {
+        int accessor = -1;
+        GltfComponentType component_type = GltfComponentType::FLOAT;
+        int components = 0;
+        bool normalized = false;
+        std::vector<char> data;
+    };
+
+    struct VertexCacheJob {
+        GltfPrimitiveRef primitive;
+        size_t vertex_count = 0;
+        std::vector<uint32_t> indices;
+        std::vector<VertexAttribute> attributes;
+        GltfVertexCacheReport report;
+        std::string error;
+    };
+
+    //Exceptions of the parallel passes are stored on their job, blockingMap would only rethrow them as QUnhandledException.
+    template<typename Job>
+    void throwJobError(const std::vector<Job>& jobs, const std::string& pass) {
+        for (const auto& job : jobs) {
+            if (!job.error.empty())
+                throw std::runtime_error(pass + " failed for mesh " + job.error);
+        }
+    }
+
+    //Stores indices with the smallest sufficient index type. Replaces the primitive's index accessor or adds one.
+    void writeIndices(GltfDocument& document, GltfPrimitiveRef& primitive, const std::vector<uint32_t>& indices, size_t vertex_count) {
+        const auto index_type = vertex_count <= 0xFFFF ? GltfComponentType::UNSIGNED_SHORT : GltfComponentType::UNSIGNED_INT;
+
+        std::vector<uint16_t> short_indices;
+        const void* index_data = indices.data();
+        if (index_type == GltfComponentType::UNSIGNED_SHORT) {
+            short_indices.assign(indices.begin(), indices.end());
+            index_data = short_indices.data();
+        }
+
+        if (primitive.json.contains("indices")) {
+            document.replaceAccessor(primitive.json.value("indices").toInt(), index_data, indices.size(), index_type, 1, false, GltfBufferTarget::ELEMENT_ARRAY_BUFFER);
+        }
+        else {
+            primitive.json["indices"] = document.appendAccessor(index_data, indices.size(), index_type, 1, false, GltfBufferTarget::ELEMENT_ARRAY_BUFFER);
+            document.setPrimitive(primitive);
+        }
+    }
+}
+
+std::vector<GltfVertexCacheReport> optimizeGltfVertexCache(GltfDocument& document) {
+    TraceSpan span("Optimize vertex cache", "kernel");
+    std::vector<VertexCacheJob> jobs;
+
+    std::set<int> processed_indices;
+    const auto use_counts = document.accessorUseCounts();
+    for (auto& primitive : document.primitives()) {
+        const auto& json = primitive.json;
+        if (json.value("mode").toInt(GLTF_MODE_TRIANGLES) != GLTF_MODE_TRIANGLES || !json.contains("indices"))
+            continue;
+
+        const auto indices_accessor = json.value("indices").toInt();
+        const auto attributes = json.value("attributes").toObject();
+        if (!attributes.contains("POSITION") || processed_indices.count(indices_accessor))
+            continue;
+        processed_indices.insert(indices_accessor);
+
+        VertexCacheJob job;
+        job.vertex_count = document.accessorCount(attributes.value("POSITION").toInt());
+        job.indices = document.readIndices(indices_accessor);
+        job.report.mesh_name = primitive.mesh_name;
+        job.report.primitive = primitive.primitive;
+
+        //Vertex data can only be reordered if no other primitive or morph target depends on its order.
+        bool reorder_vertices = !json.contains("targets") && use_counts[indices_accessor] == 1;
+        for (auto it = attributes.begin(); it != attributes.end() && reorder_vertices; ++it) {
+            const auto accessor = it.value().toInt();
+            reorder_vertices = use_counts[accessor] == 1 && document.accessorCount(accessor) == job.vertex_count;
+        }
+
+        if (reorder_vertices) {
+            try {
+                for (auto it = attributes.begin(); it != attributes.end(); ++it) {
+                    VertexAttribute attribute;
+                    attribute.accessor = it.value().toInt();
+                    attribute.component_type = document.accessorComponentType(attribute.accessor);
+                    attribute.components = document.accessorComponents(attribute.accessor);
+                    attribute.normalized = document.accessorNormalized(attribute.accessor);
+                    attribute.data = document.readAccessorElements(attribute.accessor);
+                    job.attributes.push_back(std::move(attribute));
+                }
+            }
+            catch (const std::exception&) {
+                //Sparse attributes, keep the vertex order
+                job.attributes.clear();
+            }
+        }
+
+        job.primitive = std::move(primitive);
+        jobs.push_back(std::move(job));
+    }
+
+    QtConcurrent::blockingMap(jobs, [](VertexCacheJob& job) {
+        try {
+            job.report.before = analyzeVertexCache(job.indices, job.vertex_count);
+
+            optimizeVertexCache(job.indices, job.vertex_count);
+
+            if (job.attributes.size()) {
+                const auto remap = optimizeVertexFetch(job.indices, job.vertex_count);
+                for (auto& attribute : job.attributes) {
+                    const auto element_size = gltfComponentSize(attribute.component_type) * attribute.components;
+                    attribute.data = remapVertexData(attribute.data, element_size, remap);
+                }
+                job.report.vertices_reordered = true;
+            }
+
+            job.report.after = analyzeVertexCache(job.indices, job.vertex_count);
+        }
+        catch (const std::exception& e) {
+            job.error = job.report.mesh_name + ": " + e.what();
+        }
+    });
+    throwJobError(jobs, "Vertex cache optimization");
+
+    std::vector<GltfVertexCacheReport> reports;
+    for (auto& job : jobs) {
+        writeIndices(document, job.primitive, job.indices, job.vertex_count);
+
+        for (const auto& attribute : job.attributes)
+            document.replaceAccessor(attribute.accessor, attribute.data.data(), job.vertex_count, attribute.component_type, attribute.components, attribute.normalized, GltfBufferTarget::ARRAY_BUFFER);
+
+        reports.push_back(job.report);
+    }
+
+    return reports;
+}
+
+namespace {
+    struct WeldJob {
+        GltfPrimitiveRef primitive;
+        size_t vertex_count = 0;
+        std::vector<uint32_t> indices;
+        std::vector<VertexAttribute> attributes;
+        std::vector<std::vector<float>> attribute_values;
+        std::vector<float> epsilons;
+        GltfWeldReport report;
+        std::string error;
+    };
+
+    float attributeTolerance(const QString& name, const WeldTolerances& tolerances) {
+        if (name == "POSITION")
+            return tolerances.position;
+        if (name == "NORMAL" || name == "TANGENT")
+            return tolerances.normal;
+        if (name.startsWith("TEXCOORD_") || name.startsWith("COLOR_"))
+            return tolerances.uv;
+        if (name.startsWith("WEIGHTS_"))
+            return tolerances.weight;
+        return 0.0f;
+    }
+}
+
+std::vector<GltfWeldReport> weldGltfVertices(GltfDocument& document, const WeldTolerances& tolerances) {
+    TraceSpan span("Weld vertices", "kernel");
+    std::vector<WeldJob> jobs;
+
+    const auto use_counts = document.accessorUseCounts();
+    for (auto& primitive : document.primitives()) {
+        const auto& json = primitive.json;
+        const auto attributes = json.value("attributes").toObject();
+        if (json.value("mode").toInt(GLTF_MODE_TRIANGLES) != GLTF_MODE_TRIANGLES || !attributes.contains("POSITION") || json.contains("targets"))
+            continue;
+        if (json.contains("indices") && use_counts[json.value("indices").toInt()] != 1)
+            continue;
+
+        WeldJob job;
+        job.vertex_count = document.accessorCount(attributes.value("POSITION").toInt());
+        job.report.mesh_name = primitive.mesh_name;
+        job.report.primitive = primitive.primitive;
+
+        bool weldable = true;
+        for (auto it = attributes.begin(); it != attributes.end() && weldable; ++it) {
+            const auto accessor = it.value().toInt();
+            weldable = use_counts[accessor] == 1 && document.accessorCount(accessor) == job.vertex_count;
+        }
+        if (!weldable)
+            continue;
+
+        try {
+            if (json.contains("indices")) {
+                job.indices = document.readIndices(json.value("indices").toInt());
+            }
+            else {
+                job.indices.resize(job.vertex_count);
+                for (size_t i = 0; i < job.vertex_count; ++i)
+                    job.indices[i] = static_cast<uint32_t>(i);
+            }
+
+            //Position first, it drives the spatial hash
+            std::vector<QString> names{ "POSITION" };
+            for (auto it = attributes.begin(); it != attributes.end(); ++it) {
+                if (it.key() != "POSITION")
+                    names.push_back(it.key());
+            }
+
+            for (const auto& name : names) {
+                VertexAttribute attribute;
+                attribute.accessor = attributes.value(name).toInt();
+                attribute.component_type = document.accessorComponentType(attribute.accessor);
+                attribute.components = document.accessorComponents(attribute.accessor);
+                attribute.normalized = document.accessorNormalized(attribute.accessor);
+                attribute.data = document.readAccessorElements(attribute.accessor);
+                job.attribute_values.push_back(document.readAccessor(attribute.accessor));
+                job.epsilons.push_back(attributeTolerance(name, tolerances));
+                job.attributes.push_back(std::move(attribute));
+            }
+        }
+        catch (const std::exception&) {
+            //Sparse attributes
+            continue;
+        }
+
+        job.primitive = std::move(primitive);
+        jobs.push_back(std::move(job));
+    }
+
+    QtConcurrent::blockingMap(jobs, [](WeldJob& job) {
+        try {
+            std::vector<WeldAttribute> weld_attributes;
+            for (int i = 0; i < job.attributes.size(); ++i)
+                weld_attributes.push_back({ job.attribute_values[i].data(), job.attributes[i].components, job.epsilons[i] });
+
+            std::vector<uint32_t> remap;
+            const auto unique_count = weldVertices(weld_attributes, job.vertex_count, remap);
+
+            for (auto& index : job.indices)
+                index = remap.at(index);
+            for (auto& attribute : job.attributes) {
+                const auto element_size = gltfComponentSize(attribute.component_type) * attribute.components;
+                attribute.data = compactVertexData(attribute.data, element_size, remap, unique_count);
+            }
+            job.attribute_values.clear();
+
+            job.report.vertices_before = job.vertex_count;
+            job.report.vertices_after = unique_count;
+        }
+        catch (const std::exception& e) {
+            job.error = job.report.mesh_name + ": " + e.what();
+        }
+    });
+    throwJobError(jobs, "Vertex welding");
+
+    std::vector<GltfWeldReport> reports;
+    for (auto& job : jobs) {
+        const auto vertex_count = job.report.vertices_after;
+        if (vertex_count == job.vertex_count && job.primitive.json.contains("indices"))
+            continue;
+
+        for (const auto& attribute : job.attributes)
+            document.replaceAccessor(attribute.accessor, attribute.data.data(), vertex_count, attribute.component_type, attribute.components, attribute.normalized, GltfBufferTarget::ARRAY_BUFFER);
+
+        writeIndices(document, job.primitive, job.indices, vertex_count);
+
+        reports.push_back(job.report);
+    }
+
+    return reports;
+}
+
+namespace {
+    struct NormalJob {
+        GltfPrimitiveRef primitive;
+        std::vector<uint32_t> indices;
+        std::vector<float> positions;
+        std::vector<float> source_normals;
+        std::vector<float> uvs;
+        std::vector<float> normals;
+        std::vector<float> tangents;
+        GltfNormalReport report;
+        std::string error;
+    };
+
+    //Stores a float attribute. Replaces the accessor if only this primitive uses it, otherwise adds a new one.
+    void writeFloatAttribute(GltfDocument& document, const GltfAccessorUseCounts& use_counts, GltfPrimitiveRef& primitive, const QString& name,
+        const std::vector<float>& data, int components) {
+        auto attributes = primitive.json.value("attributes").toObject();
+        const auto count = data.size() / components;
+        if (attributes.contains(name) && use_counts[attributes.value(name).toInt()] == 1) {
+            document.replaceAccessor(attributes.value(name).toInt(), data.data(), count, GltfComponentType::FLOAT, components, false, GltfBufferTarget::ARRAY_BUFFER);
+        }
+        else {
+            attributes[name] = document.appendAccessor(data.data(), count, GltfComponentType::FLOAT, components, false, GltfBufferTarget::ARRAY_BUFFER);
+            primitive.json["attributes"] = attributes;
+            document.setPrimitive(primitive);
+        }
+    }
+}
+
+std::vector<GltfNormalReport> recalculateGltfNormals(GltfDocument& document, bool generate_tangents) {
+    TraceSpan span("Recalculate normals", "kernel");
+    std::vector<NormalJob> jobs;
+
+    for (auto& primitive : document.primitives()) {
+        const auto& json = primitive.json;
+        const auto attributes = json.value("attributes").toObject();
+        if (json.value("mode").toInt(GLTF_MODE_TRIANGLES) != GLTF_MODE_TRIANGLES || !attributes.contains("POSITION"))
+            continue;
+
+        NormalJob job;
+        job.positions = document.readAccessor(attributes.value("POSITION").toInt());
+        const auto vertex_count = job.positions.size() / 3;
+        if (json.contains("indices")) {
+            job.indices = document.readIndices(json.value("indices").toInt());
+        }
+        else {
+            job.indices.resize(vertex_count);
+            for (size_t i = 0; i < vertex_count; ++i)
+                job.indices[i] = static_cast<uint32_t>(i);
+        }
+        if (attributes.contains("NORMAL"))
+            job.source_normals = document.readAccessor(attributes.value("NORMAL").toInt());
+        if (generate_tangents && attributes.contains("TEXCOORD_0"))
+            job.uvs = document.readAccessor(attributes.value("TEXCOORD_0").toInt());
+
+        if ((job.source_normals.size() && job.source_normals.size() != vertex_count * 3) || (job.uvs.size() && job.uvs.size() != vertex_count * 2))
+            continue;
+
+        job.report.mesh_name = primitive.mesh_name;
+        job.report.primitive = primitive.primitive;
+        job.report.vertices = vertex_count;
+        job.primitive = std::move(primitive);
+        jobs.push_back(std::move(job));
+    }
+
+    QtConcurrent::blockingMap(jobs, [](NormalJob& job) {
+        try {
+            const auto vertex_count = job.report.vertices;
+            job.normals = computeSmoothNormals(job.indices, job.positions.data(), job.source_normals.empty() ? nullptr : job.source_normals.data(), vertex_count);
+            if (job.uvs.size()) {
+                job.tangents = computeTangents(job.indices, job.positions.data(), job.normals.data(), job.uvs.data(), vertex_count);
+                job.report.tangents = true;
+            }
+        }
+        catch (const std::exception& e) {
+            job.error = job.report.mesh_name + ": " + e.what();
+        }
+        job.positions.clear();
+        job.source_normals.clear();
+        job.uvs.clear();
+    });
+    throwJobError(jobs, "Normal recalculation");
+
+    const auto use_counts = document.accessorUseCounts();
+    std::vector<GltfNormalReport> reports;
+    for (auto& job : jobs) {
+        writeFloatAttribute(document, use_counts, job.primitive, "NORMAL", job.normals, 3);
+        if (job.report.tangents)
+            writeFloatAttribute(document, use_counts, job.primitive, "TANGENT", job.tangents, 4);
+        reports.push_back(job.report);
+    }
+
+    return reports;
+}
+
+namespace {
+    constexpr float LOD_MAX_ERROR = 0.05f;
+    constexpr float LOD_REDUCTION = 0.5f;
+    constexpr float LOD_MIN_REDUCTION = 0.9f;
+
+    //Vertex attribute of a LOD source primitive, target is the morph target index or -1 for the primitive itself.
+    struct LodAttribute {
+        int target = -1;
+        QString name;
+        VertexAttribute attribute;
+    };
+
+    struct LodSource {
+        std::vector<float> positions;
+        std::vector<uint32_t> indices;
+        //Empty if any attribute is sparse, the levels share the source accessors then.
+        std::vector<LodAttribute> attributes;
+    };
+
+    struct LodJob {
+        int mesh = -1;
+        int primitive = -1;
+        int level = 0;
+        std::string mesh_name;
+        const LodSource* source = nullptr;
+        std::vector<uint32_t> result;
+        float result_error = 0.0f;
+        //Vertices referenced by result, compacted per attribute of the source
+        size_t vertex_count = 0;
+        std::vector<std::vector<char>> vertex_data;
+        std::string error;
+    };
+
+    //Adds a copy of the first node instancing source_mesh that instances mesh instead, under the same parent.
+    void addMeshNode(QJsonArray& nodes, QJsonArray& scenes, int source_mesh, int mesh, const QString& name) {
+        int source_node = -1;
+        for (int i = 0; i < nodes.size() && source_node == -1; ++i) {
+            if (nodes[i].toObject().value("mesh").toInt(-1) == source_mesh)
+                source_node = i;
+        }
+        if (source_node == -1)
+            return;
+
+        auto node = nodes[source_node].toObject();
+        node["mesh"] = mesh;
+        node["name"] = name;
+        node.remove("children");
+        const int node_index = nodes.size();
+        nodes.append(node);
+
+        bool has_parent = false;
+        for (int i = 0; i < nodes.size(); ++i) {
+            auto parent = nodes[i].toObject();
+            auto children = parent.value("children").toArray();
+            if (!children.contains(source_node))
+                continue;
+            children.append(node_index);
+            parent["children"] = children;
+            nodes[i] = parent;
+            has_parent = true;
+        }
+
+        if (has_parent)
+            return;
+
+        for (int i = 0; i < scenes.size(); ++i) {
+            auto scene = scenes[i].toObject();
+            auto scene_nodes = scene.value("nodes").toArray();
+            if (!scene_nodes.contains(source_node))
+                continue;
+            scene_nodes.append(node_index);
+            scene["nodes"] = scene_nodes;
+            scenes[i] = scene;
+        }
+    }
+}
+
+std::vector<GltfLodReport> generateGltfLods(GltfDocument& document, const std::unordered_map<std::string, int>& level_counts) {
+    TraceSpan span("Generate LODs", "kernel");
+    std::vector<GltfLodReport> reports;
+
+    //Gather source geometry of all triangle primitives of meshes that get LODs
+    std::vector<LodSource> sources;
+    std::vector<std::pair<GltfPrimitiveRef, int>> source_primitives;
+    auto all_primitives = document.primitives();
+    sources.reserve(all_primitives.size());
+    for (auto& primitive : all_primitives) {
+        auto level_count = level_counts.find(primitive.mesh_name);
+        if (level_count == level_counts.end() || level_count->second < 2)
+            continue;
+
+        const auto& json = primitive.json;
+        const auto attributes = json.value("attributes").toObject();
+        if (json.value("mode").toInt(GLTF_MODE_TRIANGLES) != GLTF_MODE_TRIANGLES || !attributes.contains("POSITION"))
+            continue;
+
+        LodSource source;
+        source.positions = document.readAccessor(attributes.value("POSITION").toInt());
+        if (json.contains("indices")) {
+            source.indices = document.readIndices(json.value("indices").toInt());
+        }
+        else {
+            source.indices.resize(source.positions.size() / 3);
+            for (size_t i = 0; i < source.indices.size(); ++i)
+                source.indices[i] = static_cast<uint32_t>(i);
+        }
+        try {
+            for (auto it = attributes.begin(); it != attributes.end(); ++it)
+                source.attributes.push_back({ -1, it.key(), {} });
+            const auto targets = json.value("targets").toArray();
+            for (int target = 0; target < targets.size(); ++target) {
+                const auto target_attributes = targets[target].toObject();
+                for (auto it = target_attributes.begin(); it != target_attributes.end(); ++it)
+                    source.attributes.push_back({ target, it.key(), {} });
+            }
+            for (auto& lod_attribute : source.attributes) {
+                auto& attribute = lod_attribute.attribute;
+                attribute.accessor = lod_attribute.target == -1 ? attributes.value(lod_attribute.name).toInt() :
+                    targets[lod_attribute.target].toObject().value(lod_attribute.name).toInt();
+                attribute.component_type = document.accessorComponentType(attribute.accessor);
+                attribute.components = document.accessorComponents(attribute.accessor);
+                attribute.normalized = document.accessorNormalized(attribute.accessor);
+                attribute.data = document.readAccessorElements(attribute.accessor);
+            }
+        }
+        catch (const std::exception&) {
+            //Sparse attributes
+            source.attributes.clear();
+        }
+        sources.push_back(std::move(source));
+        source_primitives.emplace_back(std::move(primitive), level_count->second);
+    }
+
+    std::vector<LodJob> jobs;
+    for (int i = 0; i < source_primitives.size(); ++i) {
+        for (int level = 1; level < source_primitives[i].second; ++level) {
+            LodJob job;
+            job.mesh = source_primitives[i].first.mesh;
+            job.primitive = i;
+            job.level = level;
+            job.mesh_name = source_primitives[i].first.mesh_name;
+            job.source = &sources[i];
+            jobs.push_back(job);
+        }
+    }
+
+    QtConcurrent::blockingMap(jobs, [](LodJob& job) {
+        try {
+            const auto& source = *job.source;
+            const auto source_vertex_count = source.positions.size() / 3;
+            const auto target_triangles = static_cast<size_t>(source.indices.size() / 3 * std::pow(LOD_REDUCTION, job.level));
+            job.result = simplifyMesh(source.indices, source.positions.data(), source_vertex_count, target_triangles * 3, LOD_MAX_ERROR, &job.result_error);
+            job.vertex_count = source_vertex_count;
+
+            //Renumber the remaining vertices from 0 and drop the unreferenced ones, which optimizeVertexFetch moves to the end
+            if (source.attributes.size()) {
+                const auto remap = optimizeVertexFetch(job.result, source_vertex_count);
+                job.vertex_count = job.result.empty() ? 0 : *std::max_element(job.result.begin(), job.result.end()) + 1;
+                for (const auto& lod_attribute : source.attributes) {
+                    const auto& attribute = lod_attribute.attribute;
+                    const auto element_size = gltfComponentSize(attribute.component_type) * attribute.components;
+                    auto data = remapVertexData(attribute.data, element_size, remap);
+                    data.resize(job.vertex_count * element_size);
+                    job.vertex_data.push_back(std::move(data));
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            job.error = job.mesh_name + ": " + e.what();
+        }
+    });
+    throwJobError(jobs, "LOD generation");
+
+    //Assemble one new mesh per source mesh and level. A level is kept if all of its primitives got reduced noticeably
+    //compared to the previous level. Meshes and nodes are written back once at the end.
+    auto meshes = document.json().value("meshes").toArray();
+    auto nodes = document.json().value("nodes").toArray();
+    auto scenes = document.json().value("scenes").toArray();
+    const auto source_mesh_count = meshes.size();
+    std::unordered_map<int, int> kept_levels;
+    for (int level = 1;; ++level) {
+        std::unordered_map<int, std::vector<const LodJob*>> level_jobs;
+        for (const auto& job : jobs) {
+            if (job.level == level)
+                level_jobs[job.mesh].push_back(&job);
+        }
+        if (level_jobs.empty())
+            break;
+
+        for (const auto& [mesh, mesh_jobs] : level_jobs) {
+            if (kept_levels[mesh] != level - 1)
+                continue;
+
+            size_t triangles = 0;
+            size_t vertices = 0;
+            size_t previous_triangles = 0;
+            float error = 0.0f;
+            for (const auto job : mesh_jobs) {
+                triangles += job->result.size() / 3;
+                vertices += job->vertex_count;
+                error = std::max(error, job->result_error);
+            }
+            for (const auto& job : jobs) {
+                if (job.mesh == mesh && job.level == level - 1)
+                    previous_triangles += job.result.size() / 3;
+            }
+            if (level == 1) {
+                for (int i = 0; i < source_primitives.size(); ++i) {
+                    if (source_primitives[i].first.mesh == mesh)
+                        previous_triangles += sources[i].indices.size() / 3;
+                }
+            }
+            if (triangles == 0 || triangles > previous_triangles * LOD_MIN_REDUCTION)
+                continue;
+
+            auto source_mesh = meshes[mesh].toObject();
+            auto lod_primitives = source_mesh.value("primitives").toArray();
+            for (const auto job : mesh_jobs) {
+                auto& primitive = source_primitives[job->primitive].first;
+                auto lod_primitive = primitive.json;
+                const auto vertex_count = job->vertex_count;
+
+                //Every level gets its own compacted vertex accessors
+                auto attributes = lod_primitive.value("attributes").toObject();
+                auto targets = lod_primitive.value("targets").toArray();
+                for (size_t i = 0; i < job->vertex_data.size(); ++i) {
+                    const auto& lod_attribute = job->source->attributes[i];
+                    const auto& attribute = lod_attribute.attribute;
+                    const auto accessor = document.appendAccessor(job->vertex_data[i].data(), vertex_count, attribute.component_type, attribute.components, attribute.normalized, GltfBufferTarget::ARRAY_BUFFER);
+                    if (lod_attribute.target == -1) {
+                        attributes[lod_attribute.name] = accessor;
+                    }
+                    else {
+                        auto target = targets[lod_attribute.target].toObject();
+                        target[lod_attribute.name] = accessor;
+                        targets[lod_attribute.target] = target;
+                    }
+                }
+                lod_primitive["attributes"] = attributes;
+                if (targets.size())
+                    lod_primitive["targets"] = targets;
+
+                if (vertex_count <= 0xFFFF) {
+                    std::vector<uint16_t> short_indices(job->result.begin(), job->result.end());
+                    lod_primitive["indices"] = document.appendAccessor(short_indices.data(), short_indices.size(), GltfComponentType::UNSIGNED_SHORT, 1, false, GltfBufferTarget::ELEMENT_ARRAY_BUFFER);
+                }
+                else {
+                    lod_primitive["indices"] = document.appendAccessor(job->result.data(), job->result.size(), GltfComponentType::UNSIGNED_INT, 1, false, GltfBufferTarget::ELEMENT_ARRAY_BUFFER);
+                }
+                lod_primitives[primitive.primitive] = lod_primitive;
+            }
+
+            const auto name = source_mesh.value("name").toString() + GLTF_LOD_SUFFIX + QString::number(level);
+            auto lod_mesh = source_mesh;
+            lod_mesh["name"] = name;
+            lod_mesh["primitives"] = lod_primitives;
+            meshes.append(lod_mesh);
+            addMeshNode(nodes, scenes, mesh, meshes.size() - 1, name);
+
+            kept_levels[mesh] = level;
+
+            GltfLodReport report;
+            report.mesh_name = name.toStdString();
+            report.level = level;
+            report.triangles = triangles;
+            report.vertices = vertices;
+            report.error = error;
+            reports.push_back(report);
+        }
+    }
+
+    if (meshes.size() != source_mesh_count) {
+        auto& json = document.json();
+        json["meshes"] = meshes;
+        if (!nodes.isEmpty())
+            json["nodes"] = nodes;
+        if (!scenes.isEmpty())
+            json["scenes"] = scenes;
+    }
+
+    //Level 0 entries and final level counts
+    for (const auto& [mesh, levels] : kept_levels) {
+        if (levels == 0)
+            continue;
+        GltfLodReport report;
+        report.mesh_name = meshes[mesh].toObject().value("name").toString().toStdString();
+        for (int i = 0; i < source_primitives.size(); ++i) {
+            if (source_primitives[i].first.mesh == mesh) {
+                report.triangles += sources[i].indices.size() / 3;
+                report.vertices += sources[i].positions.size() / 3;
+            }
+        }
+        reports.push_back(report);
+    }
+    for (auto& report : reports) {
+        const auto base_name = lodBaseName(report.mesh_name);
+        for (const auto& [mesh, levels] : kept_levels) {
+            if (levels && meshes[mesh].toObject().value("name").toString().toStdString() == base_name)
+                report.level_count = levels + 1;
+        }
+    }
+
+    return reports;
+}
+
+std::string lodBaseName(const std::string& name, int* level) {
+    if (level)
+        *level = 0;
+
+    const auto suffix_position = name.rfind(GLTF_LOD_SUFFIX);
+    if (suffix_position == std::string::npos)
+        return name;
+
+    const auto level_string = name.substr(suffix_position + strlen(GLTF_LOD_SUFFIX));
+    if (level_string.empty() || !std::all_of(level_string.begin(), level_string.end(), ::isdigit))
+        return name;
+
+    if (level)
+        *level = std::stoi(level_string);
+    return name.substr(0, suffix_position);
+}
+
+uint8_t lodMaskRange(uint8_t lod_mask, int level, int level_count) {
+    std::vector<int> bits;
+    for (int bit = 0; bit < 8; ++bit) {
+        if (lod_mask & (1 << bit))
+            bits.push_back(bit);
+    }
+    if (bits.empty() || level_count < 1 || level < 0 || level >= level_count)
+        return lod_mask;
+
+    //Levels beyond the number of available bits share the last bit.
+    const int ranges = std::min<int>(level_count, static_cast<int>(bits.size()));
+    const int range = std::min(level, ranges - 1);
+    const int begin = static_cast<int>(bits.size()) * range / ranges;
+    const int end = static_cast<int>(bits.size()) * (range + 1) / ranges;
+
+    uint8_t mask = 0;
+    for (int i = begin; i < end; ++i)
+        mask |= 1 << bits[i];
+    return mask;
+}
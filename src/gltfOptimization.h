@@ -0,0 +1,77 @@
+#pragma once
+#include "gltfDocument.h"
+#include "meshOptimization.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct GltfVertexCacheReport {
+    std::string mesh_name;
+    int primitive = 0;
+    VertexCacheStats before;
+    VertexCacheStats after;
+    bool vertices_reordered = false;
+};
+
+//Reorders the triangles of all indexed triangle list primitives for post-transform cache efficiency and the vertices
+//for fetch locality. Vertices of primitives that share vertex data with other primitives are left in place.
+//Primitives get processed in parallel.
+std::vector<GltfVertexCacheReport> optimizeGltfVertexCache(GltfDocument& document);
+
+struct WeldTolerances {
+    float position = 1e-5f;
+    float normal = 1e-3f;
+    float uv = 1e-5f;
+    float weight = 1e-3f;
+};
+
+struct GltfWeldReport {
+    std::string mesh_name;
+    int primitive = 0;
+    size_t vertices_before = 0;
+    size_t vertices_after = 0;
+};
+
+//Merges duplicate vertices of all triangle list primitives and remaps their index buffers. Non-indexed primitives get
+//an index buffer. Joint indices and unknown attributes have to match exactly. Primitives that share vertex data or
+//have morph targets are skipped. Primitives get processed in parallel.
+std::vector<GltfWeldReport> weldGltfVertices(GltfDocument& document, const WeldTolerances& tolerances);
+
+struct GltfNormalReport {
+    std::string mesh_name;
+    int primitive = 0;
+    size_t vertices = 0;
+    bool tangents = false;
+};
+
+//Replaces the normals of all triangle list primitives with angle weighted smooth normals, see computeSmoothNormals.
+//Vertex splits with differing source normals are kept as hard edges. If generate_tangents is set, primitives with
+//TEXCOORD_0 also get MikkTSpace style tangents. Primitives get processed in parallel.
+std::vector<GltfNormalReport> recalculateGltfNormals(GltfDocument& document, bool generate_tangents);
+
+//Name suffix of generated LOD meshes, followed by the level.
+constexpr char GLTF_LOD_SUFFIX[] = "_LOD";
+
+struct GltfLodReport {
+    std::string mesh_name;
+    int level = 0;
+    int level_count = 1;
+    size_t triangles = 0;
+    size_t vertices = 0;
+    float error = 0.0f;
+};
+
+//Generates simplified copies of meshes as new meshes named <name>_LOD<level>, each instanced by a copy of the original
+//mesh node. level_counts maps mesh names to the requested number of levels including the original. Every level targets
+//half the triangles of the previous one, levels that can't be reduced any further are dropped. Each level only keeps the
+//vertices its triangles reference, in accessors of its own.
+//Simplification of all levels and primitives runs in parallel. Reports one entry per level, including level 0.
+std::vector<GltfLodReport> generateGltfLods(GltfDocument& document, const std::unordered_map<std::string, int>& level_counts);
+
+//Splits a <name>_LOD<level> mesh name. Names without suffix are level 0.
+std::string lodBaseName(const std::string& name, int* level = nullptr);
+
+//Distributes the set bits of lod_mask over level_count contiguous ranges and returns the range of the given level.
+//Level 0 gets the lowest, most detailed, bits.
+uint8_t lodMaskRange(uint8_t lod_mask, int level, int level_count);
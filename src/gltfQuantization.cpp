@@ -0,0 +1,195 @@
+#include "gltfQuantization.h"
+#include "trace.h"
+
+#include <QJsonArray>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+
+namespace {
+    constexpr char KHR_MESH_QUANTIZATION[] = "KHR_mesh_quantization";
+    constexpr char EXT_MESHOPT_COMPRESSION[] = "EXT_meshopt_compression";
+
+    template<typename T>
+    std::vector<T> quantizeNormalized(const std::vector<float>& values, float min, float max, float scale) {
+        std::vector<T> quantized(values.size());
+        for (size_t i = 0; i < values.size(); ++i)
+            quantized[i] = static_cast<T>(std::lround(std::clamp(values[i], min, max) * scale));
+        return quantized;
+    }
+
+    void addExtension(QJsonObject& json, const QString& list, const QString& extension) {
+        auto extensions = json.value(list).toArray();
+        if (!extensions.contains(extension))
+            extensions.append(extension);
+        json[list] = extensions;
+    }
+
+    void removeExtension(QJsonObject& json, const QString& list, const QString& extension) {
+        auto extensions = json.value(list).toArray();
+        for (int i = extensions.size() - 1; i >= 0; --i) {
+            if (extensions[i].toString() == extension)
+                extensions.removeAt(i);
+        }
+        if (extensions.isEmpty())
+            json.remove(list);
+        else
+            json[list] = extensions;
+    }
+
+    //Quantizes all weight sets of a primitive to normalized bytes. Rounding is done with the largest remainder method
+    //so the quantized weights of each vertex sum up to exactly 255.
+    void quantizeWeights(GltfDocument& document, const std::vector<int>& weight_accessors) {
+        const auto vertex_count = document.accessorCount(weight_accessors.front());
+        const int set_count = static_cast<int>(weight_accessors.size());
+        const int influences = 4 * set_count;
+
+        std::vector<float> weights(vertex_count * influences);
+        for (int set = 0; set < set_count; ++set) {
+            const auto values = document.readAccessor(weight_accessors[set]);
+            if (values.size() != vertex_count * 4)
+                throw std::runtime_error("Mismatching weight accessor counts");
+            for (size_t v = 0; v < vertex_count; ++v)
+                std::copy_n(&values[v * 4], 4, &weights[v * influences + set * 4]);
+        }
+
+        std::vector<uint8_t> quantized(weights.size());
+        std::vector<int> order(influences);
+        for (size_t v = 0; v < vertex_count; ++v) {
+            float* w = &weights[v * influences];
+            uint8_t* q = &quantized[v * influences];
+
+            const float sum = std::accumulate(w, w + influences, 0.0f);
+            if (sum <= 0.0f)
+                continue;
+
+            int total = 0;
+            for (int i = 0; i < influences; ++i) {
+                w[i] = w[i] / sum * 255.0f;
+                q[i] = static_cast<uint8_t>(std::floor(w[i]));
+                total += q[i];
+            }
+
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [w, q](int a, int b) { return w[a] - q[a] > w[b] - q[b]; });
+            for (int i = 0; total < 255 && i < influences; ++i, ++total)
+                ++q[order[i]];
+        }
+
+        for (int set = 0; set < set_count; ++set) {
+            std::vector<uint8_t> set_data(vertex_count * 4);
+            for (size_t v = 0; v < vertex_count; ++v)
+                std::copy_n(&quantized[v * influences + set * 4], 4, &set_data[v * 4]);
+            document.replaceAccessor(weight_accessors[set], set_data.data(), vertex_count, GltfComponentType::UNSIGNED_BYTE, 4, true, GltfBufferTarget::ARRAY_BUFFER);
+        }
+    }
+}
+
+int quantizeGltf(GltfDocument& document) {
+    TraceSpan span("Quantize glTF", "kernel");
+    int quantized_count = 0;
+    bool requires_extension = false;
+
+    std::set<int> processed;
+    const auto meshes = document.json().value("meshes").toArray();
+    for (const auto& mesh : meshes) {
+        for (const auto& primitive : mesh.toObject().value("primitives").toArray()) {
+            const auto attributes = primitive.toObject().value("attributes").toObject();
+
+            std::vector<int> weight_accessors;
+            for (auto it = attributes.begin(); it != attributes.end(); ++it) {
+                const auto name = it.key();
+                const auto accessor = it.value().toInt();
+                if (processed.count(accessor) || document.accessorComponentType(accessor) != GltfComponentType::FLOAT)
+                    continue;
+
+                const auto count = document.accessorCount(accessor);
+                const auto components = document.accessorComponents(accessor);
+
+                if (name == "NORMAL" || name == "TANGENT") {
+                    const auto values = document.readAccessor(accessor);
+                    const auto quantized = quantizeNormalized<int8_t>(values, -1.0f, 1.0f, 127.0f);
+                    document.replaceAccessor(accessor, quantized.data(), count, GltfComponentType::BYTE, components, true, GltfBufferTarget::ARRAY_BUFFER);
+                    requires_extension = true;
+                }
+                else if (name.startsWith("TEXCOORD_")) {
+                    const auto values = document.readAccessor(accessor);
+                    const auto [min, max] = std::minmax_element(values.begin(), values.end());
+                    if (values.empty() || *min < -1.0f || *max > 1.0f)
+                        continue;
+                    if (*min >= 0.0f) {
+                        const auto quantized = quantizeNormalized<uint16_t>(values, 0.0f, 1.0f, 65535.0f);
+                        document.replaceAccessor(accessor, quantized.data(), count, GltfComponentType::UNSIGNED_SHORT, components, true, GltfBufferTarget::ARRAY_BUFFER);
+                    }
+                    else {
+                        const auto quantized = quantizeNormalized<int16_t>(values, -1.0f, 1.0f, 32767.0f);
+                        document.replaceAccessor(accessor, quantized.data(), count, GltfComponentType::SHORT, components, true, GltfBufferTarget::ARRAY_BUFFER);
+                        requires_extension = true;
+                    }
+                }
+                else if (name.startsWith("WEIGHTS_")) {
+                    weight_accessors.push_back(accessor);
+                    continue;
+                }
+                else {
+                    continue;
+                }
+
+                processed.insert(accessor);
+                ++quantized_count;
+            }
+
+            if (weight_accessors.size()) {
+                quantizeWeights(document, weight_accessors);
+                processed.insert(weight_accessors.begin(), weight_accessors.end());
+                quantized_count += static_cast<int>(weight_accessors.size());
+            }
+        }
+    }
+
+    if (requires_extension) {
+        addExtension(document.json(), "extensionsUsed", KHR_MESH_QUANTIZATION);
+        addExtension(document.json(), "extensionsRequired", KHR_MESH_QUANTIZATION);
+    }
+
+    return quantized_count;
+}
+
+int dequantizeGltf(GltfDocument& document) {
+    TraceSpan span("Dequantize glTF", "kernel");
+    if (document.json().value("extensionsRequired").toArray().contains(EXT_MESHOPT_COMPRESSION))
+        throw std::runtime_error("EXT_meshopt_compression compressed glTF files are not supported");
+
+    int converted_count = 0;
+
+    std::set<int> processed;
+    const auto meshes = document.json().value("meshes").toArray();
+    for (const auto& mesh : meshes) {
+        for (const auto& primitive : mesh.toObject().value("primitives").toArray()) {
+            const auto attributes = primitive.toObject().value("attributes").toObject();
+            for (auto it = attributes.begin(); it != attributes.end(); ++it) {
+                const auto name = it.key();
+                const auto accessor = it.value().toInt();
+                if (processed.count(accessor) || document.accessorComponentType(accessor) == GltfComponentType::FLOAT)
+                    continue;
+
+                if (name != "POSITION" && name != "NORMAL" && name != "TANGENT" && !name.startsWith("TEXCOORD_") && !name.startsWith("WEIGHTS_"))
+                    continue;
+
+                const auto values = document.readAccessor(accessor);
+                document.replaceAccessor(accessor, values.data(), document.accessorCount(accessor), GltfComponentType::FLOAT, document.accessorComponents(accessor), false, GltfBufferTarget::ARRAY_BUFFER);
+
+                processed.insert(accessor);
+                ++converted_count;
+            }
+        }
+    }
+
+    removeExtension(document.json(), "extensionsUsed", KHR_MESH_QUANTIZATION);
+    removeExtension(document.json(), "extensionsRequired", KHR_MESH_QUANTIZATION);
+
+    return converted_count;
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include "gltfDocument.h"
+
+//Converts normals, tangents, texture coordinates and skin weights to the compact integer formats
+//allowed by KHR_mesh_quantization. Positions are kept as floats since dequantizing them would require
+//node transforms, which are ignored for skinned meshes. Returns the number of quantized accessors.
+int quantizeGltf(GltfDocument& document);
+
+//Converts all integer vertex attributes back to floats and removes KHR_mesh_quantization from the document.
+//Returns the number of converted accessors.
+int dequantizeGltf(GltfDocument& document);
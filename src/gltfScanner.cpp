@@ -0,0 +1,287 @@
+#include "gltfScanner.h"
+#include "gltfDocument.h"
+
+#include <QFile>
+
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    class JsonCursor {
+    public:
+        JsonCursor(std::string_view json) : begin(json.data()), p(json.data()), end(json.data() + json.size()) {}
+
+        void skipWhitespace() {
+            while (p != end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+                ++p;
+        }
+
+        char peek() {
+            skipWhitespace();
+            if (p == end)
+                error("Unexpected end of json");
+            return *p;
+        }
+
+        void expect(char c) {
+            if (peek() != c)
+                error(std::string("Expected '") + c + "'");
+            ++p;
+        }
+
+        //Returns the raw string content without the quotes. Escape sequences are not resolved.
+        std::string_view string() {
+            expect('"');
+            const char* start = p;
+            while (p != end && *p != '"') {
+                if (*p == '\\' && p + 1 != end)
+                    ++p;
+                ++p;
+            }
+            if (p == end)
+                error("Unterminated string");
+            return std::string_view(start, p++ - start);
+        }
+
+        size_t integer() {
+            skipWhitespace();
+            size_t value = 0;
+            auto [ptr, ec] = std::from_chars(p, end, value);
+            if (ec != std::errc())
+                error("Expected integer");
+            p = ptr;
+            //Tolerate integral values written with fraction or exponent.
+            while (p != end && (*p == '.' || *p == 'e' || *p == 'E' || *p == '+' || *p == '-' || (*p >= '0' && *p <= '9')))
+                ++p;
+            return value;
+        }
+
+        void skipValue() {
+            const char c = peek();
+            if (c == '"') {
+                string();
+                return;
+            }
+
+            if (c == '{' || c == '[') {
+                int depth = 0;
+                while (p != end) {
+                    const char x = *p++;
+                    if (x == '"') {
+                        --p;
+                        string();
+                    }
+                    else if (x == '{' || x == '[') {
+                        ++depth;
+                    }
+                    else if (x == '}' || x == ']') {
+                        if (--depth == 0)
+                            return;
+                    }
+                }
+                error("Unterminated object or array");
+            }
+
+            //Number or literal
+            while (p != end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t')
+                ++p;
+        }
+
+        //Iterates the members of an object, calling fn(key) with the cursor positioned at the value.
+        //fn has to consume the value.
+        template<typename Fn>
+        void object(Fn&& fn) {
+            expect('{');
+            if (peek() == '}') {
+                ++p;
+                return;
+            }
+            while (true) {
+                auto key = string();
+                expect(':');
+                fn(key);
+                if (peek() == ',') {
+                    ++p;
+                    continue;
+                }
+                expect('}');
+                return;
+            }
+        }
+
+        //Iterates the elements of an array, calling fn(index) with the cursor positioned at the element.
+        template<typename Fn>
+        void array(Fn&& fn) {
+            expect('[');
+            if (peek() == ']') {
+                ++p;
+                return;
+            }
+            for (int i = 0;; ++i) {
+                fn(i);
+                if (peek() == ',') {
+                    ++p;
+                    continue;
+                }
+                expect(']');
+                return;
+            }
+        }
+
+    private:
+        const char* begin;
+        const char* p;
+        const char* end;
+
+        [[noreturn]] void error(const std::string& msg) {
+            throw std::runtime_error("Invalid glTF json at offset " + std::to_string(p - begin) + ": " + msg);
+        }
+    };
+
+    void scanMeshes(JsonCursor& cursor, GltfSummary& summary) {
+        cursor.array([&](int mesh_index) {
+            GltfSummary::Mesh mesh;
+            cursor.object([&](std::string_view key) {
+                if (key == "name") {
+                    mesh.name = cursor.string();
+                }
+                else if (key == "primitives") {
+                    cursor.array([&](int) {
+                        GltfSummary::Primitive primitive;
+                        primitive.mesh = mesh_index;
+                        cursor.object([&](std::string_view key) {
+                            if (key == "indices") {
+                                primitive.index_accessor = static_cast<int>(cursor.integer());
+                            }
+                            else if (key == "attributes") {
+                                cursor.object([&](std::string_view attribute) {
+                                    if (attribute == "POSITION")
+                                        primitive.position_accessor = static_cast<int>(cursor.integer());
+                                    else {
+                                        if (attribute.substr(0, 7) == "JOINTS_")
+                                            primitive.skinned = true;
+                                        cursor.skipValue();
+                                    }
+                                });
+                            }
+                            else {
+                                cursor.skipValue();
+                            }
+                        });
+                        summary.primitives.push_back(primitive);
+                        ++mesh.primitive_count;
+                    });
+                }
+                else {
+                    cursor.skipValue();
+                }
+            });
+            summary.meshes.push_back(mesh);
+        });
+    }
+
+    void scanAccessors(JsonCursor& cursor, GltfSummary& summary) {
+        cursor.array([&](int) {
+            size_t count = 0;
+            cursor.object([&](std::string_view key) {
+                if (key == "count")
+                    count = cursor.integer();
+                else
+                    cursor.skipValue();
+            });
+            summary.accessor_counts.push_back(count);
+        });
+    }
+
+    void scanSkins(JsonCursor& cursor, GltfSummary& summary) {
+        cursor.array([&](int) {
+            cursor.object([&](std::string_view key) {
+                if (key == "joints")
+                    cursor.array([&](int) { cursor.integer(); ++summary.joint_count; });
+                else
+                    cursor.skipValue();
+            });
+            ++summary.skin_count;
+        });
+    }
+
+    int countElements(JsonCursor& cursor) {
+        int count = 0;
+        cursor.array([&](int) { cursor.skipValue(); ++count; });
+        return count;
+    }
+}
+
+GltfSummary scanGltfJson(std::string_view json) {
+    GltfSummary summary;
+
+    JsonCursor cursor(json);
+    cursor.object([&](std::string_view key) {
+        if (key == "meshes")
+            scanMeshes(cursor, summary);
+        else if (key == "accessors")
+            scanAccessors(cursor, summary);
+        else if (key == "skins")
+            scanSkins(cursor, summary);
+        else if (key == "bufferViews")
+            summary.buffer_view_count = countElements(cursor);
+        else if (key == "nodes")
+            summary.node_count = countElements(cursor);
+        else
+            cursor.skipValue();
+    });
+
+    //Resolve accessor counts
+    for (const auto& primitive : summary.primitives) {
+        auto& mesh = summary.meshes.at(primitive.mesh);
+        if (primitive.position_accessor >= 0 && primitive.position_accessor < summary.accessor_counts.size())
+            mesh.vertex_count += summary.accessor_counts[primitive.position_accessor];
+        if (primitive.index_accessor >= 0 && primitive.index_accessor < summary.accessor_counts.size())
+            mesh.index_count += summary.accessor_counts[primitive.index_accessor];
+        mesh.skinned |= primitive.skinned;
+    }
+
+    return summary;
+}
+
+GltfFileSummary::GltfFileSummary(const std::filesystem::path& path) {
+    QFile file(QString::fromStdString(path.generic_string()));
+    if (!file.open(QIODevice::ReadOnly))
+        throw std::runtime_error("Failed to open " + path.generic_string());
+
+    const auto size = static_cast<size_t>(file.size());
+    const auto data = reinterpret_cast<const char*>(file.map(0, file.size()));
+    if (!data)
+        throw std::runtime_error("Failed to map " + path.generic_string());
+
+    std::string_view json(data, size);
+    if (isGlbFile(path)) {
+        //12 byte glb header followed by the json chunk header, the json chunk is always the first chunk.
+        uint32_t chunk_header[2];
+        if (size < 20)
+            throw std::runtime_error("Invalid glb file: Truncated header");
+        memcpy(chunk_header, data + 12, sizeof(chunk_header));
+        if (chunk_header[1] != 0x4E4F534A || 20 + static_cast<size_t>(chunk_header[0]) > size)
+            throw std::runtime_error("Invalid glb file: Missing json chunk");
+        json = std::string_view(data + 20, chunk_header[0]);
+    }
+
+    scan = scanGltfJson(json);
+
+    //Copy the mesh names out of the mapping so the file can be released.
+    size_t names_size = 0;
+    for (const auto& mesh : scan.meshes)
+        names_size += mesh.name.size();
+    names.reserve(names_size);
+    for (auto& mesh : scan.meshes) {
+        const auto offset = names.size();
+        names.append(mesh.name);
+        mesh.name = std::string_view(names.data() + offset, mesh.name.size());
+    }
+}
+
+const GltfSummary& GltfFileSummary::summary() const {
+    return scan;
+}
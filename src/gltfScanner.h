@@ -0,0 +1,49 @@
+#pragma once
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+//Summary of the parts of a glTF file that are relevant for PRIM import.
+//Strings are views into the scanned json and are only valid as long as the json data is.
+struct GltfSummary {
+    struct Primitive {
+        int mesh = -1;
+        int position_accessor = -1;
+        int index_accessor = -1;
+        bool skinned = false;
+    };
+
+    struct Mesh {
+        std::string_view name;
+        int primitive_count = 0;
+        size_t vertex_count = 0;
+        size_t index_count = 0;
+        bool skinned = false;
+    };
+
+    std::vector<Mesh> meshes;
+    std::vector<Primitive> primitives;
+    std::vector<size_t> accessor_counts;
+    int buffer_view_count = 0;
+    int node_count = 0;
+    int skin_count = 0;
+    int joint_count = 0;
+};
+
+//Single pass, on-demand glTF json scanner. Only meshes, accessors, buffer views and skins are inspected,
+//everything else gets skipped without being parsed. No allocations are made per json node.
+GltfSummary scanGltfJson(std::string_view json);
+
+//Scans a .gltf or .glb file. The file is memory mapped, the returned summary owns a copy of the mesh names.
+class GltfFileSummary {
+public:
+    explicit GltfFileSummary(const std::filesystem::path& path);
+    GltfFileSummary(const GltfFileSummary&) = delete;
+    GltfFileSummary& operator=(const GltfFileSummary&) = delete;
+
+    const GltfSummary& summary() const;
+
+private:
+    std::string names;
+    GltfSummary scan;
+};
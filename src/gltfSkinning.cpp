@@ -0,0 +1,165 @@
+#include "gltfSkinning.h"
+#include "trace.h"
+
+#include <QJsonArray>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+    struct SkinJob {
+        GltfPrimitiveRef primitive;
+        const std::vector<int>* bone_table = nullptr;
+        uint16_t fallback_joint = 0;
+        int set_count = 0;
+        std::vector<float> joints;
+        std::vector<float> weights;
+        std::vector<uint16_t> out_joints;
+        std::vector<float> out_weights;
+        GltfSkinReport report;
+    };
+
+    //Skin of the first node instancing each mesh, -1 for meshes that aren't skinned.
+    std::vector<int> meshSkins(const QJsonObject& json) {
+        std::vector<int> skins(json.value("meshes").toArray().size(), -1);
+        for (const auto& node_value : json.value("nodes").toArray()) {
+            const auto node = node_value.toObject();
+            const auto mesh = node.value("mesh").toInt(-1);
+            if (mesh >= 0 && mesh < skins.size() && skins[mesh] == -1)
+                skins[mesh] = node.value("skin").toInt(-1);
+        }
+        return skins;
+    }
+
+    //Writes one output attribute set. Shared accessors are left alone and replaced by a new one.
+    void writeAttribute(GltfDocument& document, const GltfAccessorUseCounts& use_counts, GltfPrimitiveRef& primitive, const QString& name,
+        const void* data, size_t count, GltfComponentType component_type) {
+        auto attributes = primitive.json.value("attributes").toObject();
+        if (attributes.contains(name) && use_counts[attributes.value(name).toInt()] == 1) {
+            document.replaceAccessor(attributes.value(name).toInt(), data, count, component_type, 4, false, GltfBufferTarget::ARRAY_BUFFER);
+        }
+        else {
+            attributes[name] = document.appendAccessor(data, count, component_type, 4, false, GltfBufferTarget::ARRAY_BUFFER);
+            primitive.json["attributes"] = attributes;
+        }
+    }
+}
+
+std::vector<GltfSkinReport> processGltfSkinWeights(GltfDocument& document, const std::function<int(const std::string& joint_name)>& bone_index) {
+    TraceSpan span("Process skin weights", "kernel");
+    const auto& json = document.json();
+    const auto nodes = json.value("nodes").toArray();
+    const auto skins = json.value("skins").toArray();
+
+    //Joint names are interned so every distinct name is looked up in the rig only once, even across skins.
+    std::unordered_map<std::string, int> interned_bones;
+    std::vector<std::vector<int>> bone_tables(skins.size());
+    std::vector<uint16_t> fallback_joints(skins.size(), 0);
+    for (int skin = 0; skin < skins.size(); ++skin) {
+        const auto joints = skins[skin].toObject().value("joints").toArray();
+        auto& table = bone_tables[skin];
+        table.resize(joints.size(), -1);
+        bool has_fallback = false;
+        for (int joint = 0; joint < joints.size(); ++joint) {
+            const auto name = nodes[joints[joint].toInt()].toObject().value("name").toString().toStdString();
+            auto interned = interned_bones.find(name);
+            if (interned == interned_bones.end())
+                interned = interned_bones.emplace(name, bone_index(name)).first;
+            table[joint] = interned->second;
+
+            if (!has_fallback && table[joint] >= 0) {
+                fallback_joints[skin] = static_cast<uint16_t>(joint);
+                has_fallback = true;
+            }
+        }
+    }
+
+    const auto mesh_skins = meshSkins(json);
+
+    std::vector<SkinJob> jobs;
+    for (auto& primitive : document.primitives()) {
+        const auto skin = mesh_skins[primitive.mesh];
+        const auto attributes = primitive.json.value("attributes").toObject();
+        if (skin < 0 || skin >= skins.size() || !attributes.contains("JOINTS_0") || !attributes.contains("WEIGHTS_0"))
+            continue;
+
+        SkinJob job;
+        job.bone_table = &bone_tables[skin];
+        job.fallback_joint = fallback_joints[skin];
+        while (attributes.contains(QString("JOINTS_%1").arg(job.set_count)) && attributes.contains(QString("WEIGHTS_%1").arg(job.set_count)))
+            ++job.set_count;
+        if (job.set_count * 4 > MAX_SKIN_INFLUENCES)
+            throw std::runtime_error("Mesh " + primitive.mesh_name + " has more than " + std::to_string(MAX_SKIN_INFLUENCES) + " bone influences per vertex");
+
+        const auto vertex_count = document.accessorCount(attributes.value("JOINTS_0").toInt());
+        const auto influences = job.set_count * 4;
+        job.joints.resize(vertex_count * influences);
+        job.weights.resize(vertex_count * influences);
+        for (int set = 0; set < job.set_count; ++set) {
+            const auto joints = document.readAccessor(attributes.value(QString("JOINTS_%1").arg(set)).toInt());
+            const auto weights = document.readAccessor(attributes.value(QString("WEIGHTS_%1").arg(set)).toInt());
+            if (joints.size() != vertex_count * 4 || weights.size() != vertex_count * 4)
+                throw std::runtime_error("Mismatching joint and weight accessor counts in mesh " + primitive.mesh_name);
+            for (size_t v = 0; v < vertex_count; ++v) {
+                std::copy_n(&joints[v * 4], 4, &job.joints[v * influences + set * 4]);
+                std::copy_n(&weights[v * 4], 4, &job.weights[v * influences + set * 4]);
+            }
+        }
+
+        job.report.mesh_name = primitive.mesh_name;
+        job.report.primitive = primitive.primitive;
+        job.report.vertices = vertex_count;
+        job.primitive = std::move(primitive);
+        jobs.push_back(std::move(job));
+    }
+
+    QtConcurrent::blockingMap(jobs, [](SkinJob& job) {
+        job.report.stats = limitSkinWeights(job.joints.data(), job.weights.data(), job.report.vertices, job.set_count * 4,
+            *job.bone_table, job.fallback_joint, job.out_joints, job.out_weights);
+        job.joints.clear();
+        job.weights.clear();
+    });
+
+    const auto use_counts = document.accessorUseCounts();
+    std::vector<GltfSkinReport> reports;
+    for (auto& job : jobs) {
+        const auto vertex_count = job.report.vertices;
+        const int out_sets = std::min(job.set_count, SKIN_WEIGHT_SLOTS / 4);
+
+        uint16_t max_joint = 0;
+        for (const auto joint : job.out_joints)
+            max_joint = std::max(max_joint, joint);
+
+        for (int set = 0; set < out_sets; ++set) {
+            std::vector<uint16_t> joints(vertex_count * 4);
+            std::vector<float> weights(vertex_count * 4);
+            for (size_t v = 0; v < vertex_count; ++v) {
+                std::copy_n(&job.out_joints[v * SKIN_WEIGHT_SLOTS + set * 4], 4, &joints[v * 4]);
+                std::copy_n(&job.out_weights[v * SKIN_WEIGHT_SLOTS + set * 4], 4, &weights[v * 4]);
+            }
+
+            if (max_joint <= 0xFF) {
+                std::vector<uint8_t> byte_joints(joints.begin(), joints.end());
+                writeAttribute(document, use_counts, job.primitive, QString("JOINTS_%1").arg(set), byte_joints.data(), vertex_count, GltfComponentType::UNSIGNED_BYTE);
+            }
+            else {
+                writeAttribute(document, use_counts, job.primitive, QString("JOINTS_%1").arg(set), joints.data(), vertex_count, GltfComponentType::UNSIGNED_SHORT);
+            }
+            writeAttribute(document, use_counts, job.primitive, QString("WEIGHTS_%1").arg(set), weights.data(), vertex_count, GltfComponentType::FLOAT);
+        }
+
+        auto attributes = job.primitive.json.value("attributes").toObject();
+        for (int set = out_sets; set < job.set_count; ++set) {
+            attributes.remove(QString("JOINTS_%1").arg(set));
+            attributes.remove(QString("WEIGHTS_%1").arg(set));
+        }
+        job.primitive.json["attributes"] = attributes;
+        document.setPrimitive(job.primitive);
+
+        reports.push_back(job.report);
+    }
+
+    return reports;
+}
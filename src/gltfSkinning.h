@@ -0,0 +1,20 @@
+#pragma once
+#include "gltfDocument.h"
+#include "skinWeights.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+struct GltfSkinReport {
+    std::string mesh_name;
+    int primitive = 0;
+    size_t vertices = 0;
+    SkinWeightStats stats;
+};
+
+//Resolves the joints of every skin to rig bone indices once, bone_index returns -1 for names missing from the rig.
+//Skin weights of all skinned primitives get limited to MAX_BONE_INFLUENCES, normalized and quantized to 1/255 steps,
+//see limitSkinWeights. Joint indices stay skin joint indices. Results are written as JOINTS_0/1 and WEIGHTS_0/1.
+//Primitives get processed in parallel.
+std::vector<GltfSkinReport> processGltfSkinWeights(GltfDocument& document, const std::function<int(const std::string& joint_name)>& bone_index);
@@ -1,8 +1,13 @@
 #include "mainwindow.h"
+#include "patchIndex.h"
 #include "GlacierFormats.h"
+#include "trace.h"
 
 #include <iostream>
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QEventLoop>
+#include <QFutureWatcher>
 #include <QtConcurrent/qtconcurrentrun.h>
 
 void initAppStyle() {
@@ -48,17 +53,52 @@ void initGlacierFormats() {
     progressDialog.setLabel(new QLabel("Initilizing GlacierFormats, this might take a few seconds...", &progressDialog));
     progressDialog.show();
 
-    auto future = QtConcurrent::run(&GlacierFormats::GlacierInit);
-    while (!future.isFinished()) {
-        qApp->processEvents();
-        Sleep(33);
-    }
+    //GlacierInit can't be interrupted, canceling the dialog exits once it returns.
+    QFutureWatcher<void> watcher;
+    QEventLoop loop;
+    QObject::connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+    watcher.setFuture(QtConcurrent::run(&GlacierFormats::GlacierInit));
+    if (!watcher.isFinished())
+        loop.exec();
     if (progressDialog.wasCanceled())
         exit(0);
 
     progressDialog.close();
 }
 
+//--log-file <path> writes the console log to a file, --log-level <status|warning|error> limits what gets written.
+//--trace-dir <directory> enables tracing, imports and exports write a Chrome trace and print a timing summary.
+void initLogging(const QApplication& app) {
+    QCommandLineParser parser;
+    QCommandLineOption logFileOption("log-file", "Writes the log to <file>.", "file");
+    QCommandLineOption logLevelOption("log-level", "Minimum level of logged messages: status, warning or error.", "level", "status");
+    QCommandLineOption traceDirOption("trace-dir", "Writes traces of imports and exports to <directory>.", "directory");
+    parser.addOption(logFileOption);
+    parser.addOption(logLevelOption);
+    parser.addOption(traceDirOption);
+    parser.parse(app.arguments());
+
+    if (parser.isSet(traceDirOption))
+        Tracer::instance().enable(parser.value(traceDirOption).toStdString());
+
+    if (!parser.isSet(logFileOption))
+        return;
+
+    const auto levelName = parser.value(logLevelOption).toLower();
+    auto level = LogLevel::Status;
+    if (levelName == "warning")
+        level = LogLevel::Warning;
+    else if (levelName == "error")
+        level = LogLevel::Error;
+
+    try {
+        Console::instance().setFileSink(parser.value(logFileOption).toStdString(), level);
+    }
+    catch (const std::exception& e) {
+        printError(e.what());
+    }
+}
+
 int main(int argc, char *argv[]) {
 
 #ifndef _DEBUG
@@ -68,7 +108,11 @@ int main(int argc, char *argv[]) {
 
     initAppStyle();
 
+    initLogging(app);
+
     initGlacierFormats();
+    //Created right away so the index knows which patches the repository was loaded from.
+    PatchIndex::instance();
 
     MainWindow window;
     QSize windowSize(1200, 800);
@@ -4,6 +4,7 @@
 #include "Console.h"
 #include "textureImport.h"
 #include "materialEditorWidget.h"
+#include "patchTool.h"
 
 #include <regex>
 #include <Windows.h>
@@ -36,7 +37,8 @@ MainWindow::MainWindow(QWidget* parent) : QWidget(parent) {
     tabs->addTab(importWidget, "Prim Import" );
     tabs->addTab(new materialEditorWidget(this), "Material Editor");
     //tabs->addTab(new TextureToolWidget(this), "Texture Tool" );
-    //tabs->addTab(new QWidget(this), "Patch Tool" );
+    auto patchTool = new PatchToolWidget(this);
+    tabs->addTab(patchTool, "Patch Tool" );
 
     console = new ConsoleWidget(this);
     console->setMaximumHeight(250);
@@ -45,10 +47,9 @@ MainWindow::MainWindow(QWidget* parent) : QWidget(parent) {
     layout->addWidget(console, 2, 0, 1, 3);
 
     auto footer = new FooterWidget(this);
-    connect(importWidget, SIGNAL(importStarted()), footer, SLOT(startSpinner()));
-    connect(importWidget, SIGNAL(importFinished()), footer, SLOT(stopSpinner()));
-    connect(exportWidget, SIGNAL(exportStarted()), footer, SLOT(startSpinner()));
-    connect(exportWidget, SIGNAL(exportFinished()), footer, SLOT(stopSpinner()));
+    footer->trackJob(importWidget->job());
+    footer->trackJob(exportWidget->job());
+    footer->trackJob(patchTool->job());
     layout->addWidget(footer, 3, 0, 1, 3);
 }
 
@@ -73,9 +74,25 @@ FooterWidget::FooterWidget(QWidget* parent) : QWidget(parent) {
     spinnerLabel->setMovie(movie);
     spinnerLabel->movie()->start();
     spinnerLabel->movie()->stop();
-    spinnerLabel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+    spinnerLabel->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
     layout->addWidget(spinnerLabel);
 
+    stageLabel = new QLabel(this);
+    stageLabel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+    layout->addWidget(stageLabel);
+
+    progressBar = new QProgressBar(this);
+    progressBar->setRange(0, PROGRESS_STEPS);
+    progressBar->setValue(0);
+    progressBar->setTextVisible(false);
+    progressBar->setMaximumWidth(200);
+    layout->addWidget(progressBar);
+
+    cancelButton = new QPushButton("Cancel", this);
+    cancelButton->setToolTip("Stops the running job at the next stage");
+    cancelButton->setEnabled(false);
+    layout->addWidget(cancelButton);
+
     auto exitButton = new QPushButton("Exit", this);
     connect(exitButton, SIGNAL(clicked()), SLOT(exitClicked()));
     layout->addWidget(exitButton);
@@ -83,15 +100,35 @@ FooterWidget::FooterWidget(QWidget* parent) : QWidget(parent) {
     setLayout(layout);
 }
 
+//Shows spinner, stage and progress of the job while it runs. The cancel button cancels all tracked jobs that are running.
+void FooterWidget::trackJob(BackgroundJob* job) {
+    connect(job, SIGNAL(started()), SLOT(startSpinner()));
+    connect(job, SIGNAL(finished(bool)), SLOT(stopSpinner()));
+    connect(job, SIGNAL(stageChanged(const QString&)), stageLabel, SLOT(setText(const QString&)));
+    connect(job, SIGNAL(progressChanged(float)), SLOT(setProgress(float)));
+    connect(cancelButton, SIGNAL(clicked()), job, SLOT(cancel()));
+}
+
+void FooterWidget::setProgress(float progress) {
+    progressBar->setValue(static_cast<int>(progress * PROGRESS_STEPS));
+}
+
 void FooterWidget::exitClicked() {
     exit(0);
 }
 
 void FooterWidget::startSpinner() {
+    ++runningJobs;
+    cancelButton->setEnabled(true);
     spinnerLabel->movie()->start();
 }
 
 void FooterWidget::stopSpinner() {
+    if (--runningJobs > 0)
+        return;
+    runningJobs = 0;
+    cancelButton->setEnabled(false);
+    stageLabel->clear();
     spinnerLabel->movie()->stop();
     spinnerLabel->movie()->start();
     spinnerLabel->movie()->stop();
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "backgroundJob.h"
 #include "Console.h"
 #include "primImport.h"
 #include "primExport.h"
@@ -28,13 +29,22 @@ class FooterWidget : public QWidget {
     Q_OBJECT
 
 private:
+    static constexpr int PROGRESS_STEPS = 1000;
+
     QLabel* spinnerLabel;
+    QLabel* stageLabel;
+    QProgressBar* progressBar;
+    QPushButton* cancelButton;
+    int runningJobs = 0;
 
 public:
     FooterWidget(QWidget* parent);
 
+    void trackJob(BackgroundJob* job);
+
 private slots:
     void exitClicked();
+    void setProgress(float progress);
 
 public slots:
     void startSpinner();
@@ -0,0 +1,322 @@
+#include "meshNormals.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+    using Vec3 = std::array<float, 3>;
+
+    Vec3 load(const float* data, size_t index) {
+        return { data[3 * index + 0], data[3 * index + 1], data[3 * index + 2] };
+    }
+
+    Vec3 sub(const Vec3& a, const Vec3& b) {
+        return { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+    }
+
+    Vec3 cross(const Vec3& a, const Vec3& b) {
+        return { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+    }
+
+    float dot(const Vec3& a, const Vec3& b) {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    bool normalize(Vec3& v) {
+        const float length = std::sqrt(dot(v, v));
+        if (!(length > 1e-20f))
+            return false;
+        for (auto& c : v)
+            c /= length;
+        return true;
+    }
+
+    //Angle between the edges a->b and a->c.
+    float cornerAngle(const Vec3& a, const Vec3& b, const Vec3& c) {
+        auto e0 = sub(b, a);
+        auto e1 = sub(c, a);
+        if (!normalize(e0) || !normalize(e1))
+            return 0.0f;
+        return std::acos(std::fmax(-1.0f, std::fmin(1.0f, dot(e0, e1))));
+    }
+
+    struct VertexKeyHash {
+        size_t operator()(const std::vector<uint32_t>& key) const noexcept {
+            size_t hash = 0;
+            for (const auto value : key)
+                hash = hash * 0x9E3779B1u ^ value;
+            return hash;
+        }
+    };
+
+    //Groups vertices whose first components floats of each stream are bitwise equal. Returns the group of each vertex.
+    std::vector<uint32_t> groupVertices(const std::vector<std::pair<const float*, int>>& streams, size_t vertex_count, std::vector<std::vector<uint32_t>>& groups) {
+        std::unordered_map<std::vector<uint32_t>, uint32_t, VertexKeyHash> lookup;
+        lookup.reserve(vertex_count);
+
+        std::vector<uint32_t> vertex_groups(vertex_count);
+        std::vector<uint32_t> key;
+        for (size_t v = 0; v < vertex_count; ++v) {
+            key.clear();
+            for (const auto& [data, components] : streams) {
+                for (int c = 0; c < components; ++c) {
+                    uint32_t bits;
+                    float value = data[v * components + c];
+                    if (value == 0.0f)
+                        value = 0.0f; //Merges -0 and +0
+                    memcpy(&bits, &value, sizeof(bits));
+                    key.push_back(bits);
+                }
+            }
+
+            auto [group, inserted] = lookup.try_emplace(key, static_cast<uint32_t>(groups.size()));
+            if (inserted)
+                groups.emplace_back();
+            groups[group->second].push_back(static_cast<uint32_t>(v));
+            vertex_groups[v] = group->second;
+        }
+        return vertex_groups;
+    }
+}
+
+std::vector<float> computeSmoothNormals(const std::vector<uint32_t>& indices, const float* positions, const float* source_normals,
+    size_t vertex_count, float hard_edge_cos, float crease_cos) {
+    //Face normals and corner angles of all non degenerate triangles
+    const size_t triangle_count = indices.size() / 3;
+    std::vector<Vec3> face_normals(triangle_count, Vec3{ 0.0f, 0.0f, 0.0f });
+    std::vector<float> corner_angles(triangle_count * 3, 0.0f);
+    std::vector<bool> valid_faces(triangle_count, false);
+    std::vector<uint32_t> corner_offsets(vertex_count + 1, 0);
+    for (size_t t = 0; t < triangle_count; ++t) {
+        const uint32_t corners[3] = { indices[3 * t + 0], indices[3 * t + 1], indices[3 * t + 2] };
+        const Vec3 p[3] = { load(positions, corners[0]), load(positions, corners[1]), load(positions, corners[2]) };
+
+        auto normal = cross(sub(p[1], p[0]), sub(p[2], p[0]));
+        if (!normalize(normal))
+            continue;
+
+        face_normals[t] = normal;
+        valid_faces[t] = true;
+        for (int c = 0; c < 3; ++c) {
+            corner_angles[3 * t + c] = cornerAngle(p[c], p[(c + 1) % 3], p[(c + 2) % 3]);
+            ++corner_offsets[corners[c] + 1];
+        }
+    }
+
+    //Corners of the non degenerate triangles grouped by vertex
+    for (size_t v = 0; v < vertex_count; ++v)
+        corner_offsets[v + 1] += corner_offsets[v];
+    std::vector<uint32_t> vertex_corners(corner_offsets.back());
+    {
+        auto next = corner_offsets;
+        for (size_t i = 0; i < triangle_count * 3; ++i) {
+            if (valid_faces[i / 3])
+                vertex_corners[next[indices[i]]++] = static_cast<uint32_t>(i);
+        }
+    }
+
+    std::vector<std::vector<uint32_t>> groups;
+    const auto vertex_groups = groupVertices({ { positions, 3 } }, vertex_count, groups);
+
+    std::vector<float> normals(vertex_count * 3);
+    for (size_t v = 0; v < vertex_count; ++v) {
+        const auto own_begin = vertex_corners.begin() + corner_offsets[v];
+        const auto own_end = vertex_corners.begin() + corner_offsets[v + 1];
+        auto withinCrease = [&](const Vec3& face_normal) {
+            //Vertices without faces of their own take the smooth normal of their position
+            if (own_begin == own_end)
+                return true;
+            return std::any_of(own_begin, own_end, [&](uint32_t corner) { return dot(face_normals[corner / 3], face_normal) >= crease_cos; });
+        };
+
+        Vec3 normal = { 0.0f, 0.0f, 0.0f };
+        for (const auto other : groups[vertex_groups[v]]) {
+            if (source_normals && other != v && dot(load(source_normals, v), load(source_normals, other)) < hard_edge_cos)
+                continue;
+            for (auto corner = corner_offsets[other]; corner < corner_offsets[other + 1]; ++corner) {
+                const auto face_corner = vertex_corners[corner];
+                const auto& face_normal = face_normals[face_corner / 3];
+                if (other != v && !withinCrease(face_normal))
+                    continue;
+                for (int k = 0; k < 3; ++k)
+                    normal[k] += face_normal[k] * corner_angles[face_corner];
+            }
+        }
+
+        if (!normalize(normal)) {
+            normal = source_normals ? load(source_normals, v) : Vec3{ 0.0f, 0.0f, 1.0f };
+            if (!normalize(normal))
+                normal = { 0.0f, 0.0f, 1.0f };
+        }
+        memcpy(&normals[v * 3], normal.data(), sizeof(normal));
+    }
+    return normals;
+}
+
+std::vector<float> computeTangents(const std::vector<uint32_t>& indices, const float* positions, const float* normals,
+    const float* uvs, size_t vertex_count) {
+    std::vector<Vec3> tangents(vertex_count, Vec3{ 0.0f, 0.0f, 0.0f });
+    std::vector<Vec3> bitangents(vertex_count, Vec3{ 0.0f, 0.0f, 0.0f });
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const uint32_t corners[3] = { indices[i + 0], indices[i + 1], indices[i + 2] };
+        const Vec3 p[3] = { load(positions, corners[0]), load(positions, corners[1]), load(positions, corners[2]) };
+
+        //glTF has its uv origin in the top left corner, MikkTSpace expects it in the bottom left.
+        float u[3], v[3];
+        for (int c = 0; c < 3; ++c) {
+            u[c] = uvs[2 * corners[c] + 0];
+            v[c] = 1.0f - uvs[2 * corners[c] + 1];
+        }
+
+        const auto e1 = sub(p[1], p[0]);
+        const auto e2 = sub(p[2], p[0]);
+        const float du1 = u[1] - u[0], dv1 = v[1] - v[0];
+        const float du2 = u[2] - u[0], dv2 = v[2] - v[0];
+        const float area = du1 * dv2 - du2 * dv1;
+        if (std::fabs(area) < 1e-20f)
+            continue;
+
+        Vec3 tangent, bitangent;
+        for (int k = 0; k < 3; ++k) {
+            tangent[k] = (e1[k] * dv2 - e2[k] * dv1) / area;
+            bitangent[k] = (e2[k] * du1 - e1[k] * du2) / area;
+        }
+        if (!normalize(tangent) || !normalize(bitangent))
+            continue;
+
+        for (int c = 0; c < 3; ++c) {
+            const float angle = cornerAngle(p[c], p[(c + 1) % 3], p[(c + 2) % 3]);
+            for (int k = 0; k < 3; ++k) {
+                tangents[corners[c]][k] += tangent[k] * angle;
+                bitangents[corners[c]][k] += bitangent[k] * angle;
+            }
+        }
+    }
+
+    //Vertices that only got split for attributes other than position, normal and uv share their tangent frame.
+    std::vector<std::vector<uint32_t>> groups;
+    const auto vertex_groups = groupVertices({ { positions, 3 }, { normals, 3 }, { uvs, 2 } }, vertex_count, groups);
+
+    std::vector<float> result(vertex_count * 4);
+    for (size_t v = 0; v < vertex_count; ++v) {
+        Vec3 tangent = { 0.0f, 0.0f, 0.0f };
+        Vec3 bitangent = { 0.0f, 0.0f, 0.0f };
+        for (const auto other : groups[vertex_groups[v]]) {
+            for (int k = 0; k < 3; ++k) {
+                tangent[k] += tangents[other][k];
+                bitangent[k] += bitangents[other][k];
+            }
+        }
+
+        //Gram-Schmidt against the normal, falls back to any perpendicular direction for degenerate uvs.
+        const auto normal = load(normals, v);
+        const float projection = dot(normal, tangent);
+        for (int k = 0; k < 3; ++k)
+            tangent[k] -= normal[k] * projection;
+        if (!normalize(tangent)) {
+            tangent = std::fabs(normal[0]) < 0.9f ? cross(normal, Vec3{ 1.0f, 0.0f, 0.0f }) : cross(normal, Vec3{ 0.0f, 1.0f, 0.0f });
+            if (!normalize(tangent))
+                tangent = { 1.0f, 0.0f, 0.0f };
+        }
+
+        const float sign = dot(cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+        memcpy(&result[v * 4], tangent.data(), sizeof(tangent));
+        result[v * 4 + 3] = sign;
+    }
+    return result;
+}
+
+std::vector<float> calculateNormals(const std::vector<unsigned short>& index_buffer, const std::vector<float>& vertex_buffer) {
+    std::vector<float> normals(vertex_buffer.size(), 0.0f);
+    const float* positions = vertex_buffer.data();
+
+    for (size_t i = 0; i + 2 < index_buffer.size(); i += 3) {
+        const auto a = load(positions, index_buffer[i + 0]);
+        const auto b = load(positions, index_buffer[i + 1]);
+        const auto c = load(positions, index_buffer[i + 2]);
+        const auto n = cross(sub(b, a), sub(c, a));
+
+        for (int corner = 0; corner < 3; ++corner) {
+            float* normal = &normals[3 * index_buffer[i + corner]];
+            normal[0] += n[0];
+            normal[1] += n[1];
+            normal[2] += n[2];
+        }
+    }
+
+    for (size_t v = 0; v < normals.size() / 3; ++v) {
+        auto normal = load(normals.data(), v);
+        if (!normalize(normal))
+            normal = { 0.0f, 0.0f, 0.0f };
+        memcpy(&normals[3 * v], normal.data(), sizeof(normal));
+    }
+    return normals;
+}
+
+std::array<char, 3> findTransformation(const std::vector<float>& normals, const std::vector<float>& reference_normals) {
+    //Every output axis maps to one of six signed source axes, the votes for each combination are counted in a flat table.
+    constexpr int SIGNED_AXES = 6;
+    std::array<size_t, SIGNED_AXES * SIGNED_AXES * SIGNED_AXES> votes{};
+    auto signedAxisIndex = [](int axis) { return axis > 0 ? axis - 1 : 2 - axis; };
+
+    const size_t count = std::min(normals.size(), reference_normals.size()) / 3 * 3;
+    for (size_t i = 0; i < count; i += 3) {
+        int combination = 0;
+        for (int j = 0; j < 3; ++j) {
+            const auto v = std::fabs(reference_normals[i + j]);
+            int offset = 0;
+            for (int k = 1; k < 3; ++k) {
+                if (std::fabs(std::fabs(normals[i + k]) - v) < std::fabs(std::fabs(normals[i + offset]) - v))
+                    offset = k;
+            }
+            const int axis = (std::signbit(reference_normals[i + j]) == std::signbit(normals[i + j])) ? (offset + 1) : -(offset + 1);
+            combination = combination * SIGNED_AXES + signedAxisIndex(axis);
+        }
+        ++votes[combination];
+    }
+
+    if (count == 0)
+        return { 1, 2, 3 };
+
+    auto combination = static_cast<int>(std::distance(votes.begin(), std::max_element(votes.begin(), votes.end())));
+    std::array<char, 3> transform;
+    for (int j = 2; j >= 0; --j) {
+        const int index = combination % SIGNED_AXES;
+        transform[j] = static_cast<char>(index < 3 ? index + 1 : -(index - 2));
+        combination /= SIGNED_AXES;
+    }
+    return transform;
+}
+
+void reorientNormals(const std::vector<unsigned short>& index_buffer, const std::vector<float>& vertex_buffer, std::vector<float>& normals) {
+    const auto reference_normals = calculateNormals(index_buffer, vertex_buffer);
+    const auto transform = findTransformation(normals, reference_normals);
+
+    for (size_t i = 0; i + 2 < normals.size(); i += 3) {
+        float normal[3];
+        for (int j = 0; j < 3; ++j) {
+            normal[j] = normals[i + std::abs(transform[j]) - 1];
+            if (transform[j] < 0)
+                normal[j] = -normal[j];
+        }
+        memcpy(&normals[i], normal, sizeof(normal));
+    }
+}
+
+void convertNormals(std::vector<float>& normals, bool invert_x, bool invert_y, bool invert_z) {
+    const float sx = invert_x ? -1.0f : 1.0f;
+    const float sy = invert_y ? -1.0f : 1.0f;
+    const float sz = invert_z ? -1.0f : 1.0f;
+    for (size_t i = 0; i + 2 < normals.size(); i += 3) {
+        const float x = normals[i + 0] * sx;
+        const float y = normals[i + 1] * sy;
+        const float z = normals[i + 2] * sz;
+        normals[i + 0] = x;
+        normals[i + 1] = -z;
+        normals[i + 2] = y;
+    }
+}
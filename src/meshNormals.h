@@ -0,0 +1,35 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Computes angle weighted smooth vertex normals of an indexed triangle list. Vertices sharing a position get smoothed
+//together, so splits made for uv or material seams don't show. Faces of other vertices at the same position only
+//contribute if their normal is within the crease angle, cos >= crease_cos, of a face of the vertex itself, so split
+//vertices along sharp edges stay hard. If source normals are given, vertices at the same position whose source normals
+//differ by more than hard_edge_cos are treated as hard edge split and kept apart as well.
+std::vector<float> computeSmoothNormals(const std::vector<uint32_t>& indices, const float* positions, const float* source_normals,
+    size_t vertex_count, float hard_edge_cos = 0.999f, float crease_cos = 0.5f);
+
+//Computes tangents following the MikkTSpace conventions: per corner tangent and bitangent directions from the uv
+//gradients, weighted by corner angle, averaged over vertices with equal position, normal and uv, orthogonalized
+//against the normal. The bitangent sign is stored in w. Returns four floats per vertex.
+std::vector<float> computeTangents(const std::vector<uint32_t>& indices, const float* positions, const float* normals,
+    const float* uvs, size_t vertex_count);
+
+//Area weighted face normals accumulated per vertex of a 16 bit indexed triangle list with tightly packed positions.
+//Vertices without any non degenerate triangle get a zero normal. Before the move out of the import code they were
+//normalized to NaN, which made their vote in findTransformation depend on how NaN compares. A zero normal votes
+//deterministically, so reorientNormals can pick a different orientation than before for meshes with many such vertices.
+std::vector<float> calculateNormals(const std::vector<unsigned short>& index_buffer, const std::vector<float>& vertex_buffer);
+
+//Finds the axis permutation and sign flips that map normals onto reference_normals for most vertices.
+//Component j of the result is the 1 based source axis of output axis j, negative if it gets flipped.
+std::array<char, 3> findTransformation(const std::vector<float>& normals, const std::vector<float>& reference_normals);
+
+//Rotates and reflects the normals into the orientation that matches the winding of the mesh.
+void reorientNormals(const std::vector<unsigned short>& index_buffer, const std::vector<float>& vertex_buffer, std::vector<float>& normals);
+
+//Converts glTF normals into the PRIM coordinate system (x, -z, y), inverting the selected glTF axes first.
+void convertNormals(std::vector<float>& normals, bool invert_x, bool invert_y, bool invert_z);
@@ -0,0 +1,541 @@
+#include "meshOptimization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count, int cache_size) {
+    VertexCacheStats stats;
+    if (indices.empty() || vertex_count == 0)
+        return stats;
+
+    //Timestamp based FIFO: a vertex is in the cache if it got inserted less than cache_size misses ago.
+    std::vector<size_t> insertion_time(vertex_count, 0);
+    size_t misses = 0;
+    for (const auto index : indices) {
+        if (insertion_time[index] == 0 || misses - insertion_time[index] >= static_cast<size_t>(cache_size)) {
+            ++misses;
+            insertion_time[index] = misses;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / (indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / vertex_count;
+    return stats;
+}
+
+namespace {
+    constexpr int CACHE_SIZE = 32;
+    constexpr float CACHE_DECAY_POWER = 1.5f;
+    constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+    constexpr float VALENCE_BOOST_SCALE = 2.0f;
+    constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+    float vertexScore(int cache_position, uint32_t remaining_triangles) {
+        if (remaining_triangles == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+        if (cache_position >= 0) {
+            if (cache_position < 3) {
+                score = LAST_TRIANGLE_SCORE;
+            }
+            else {
+                const float scaler = 1.0f / (CACHE_SIZE - 3);
+                score = std::pow(1.0f - (cache_position - 3) * scaler, CACHE_DECAY_POWER);
+            }
+        }
+
+        score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining_triangles), -VALENCE_BOOST_POWER);
+        return score;
+    }
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertex_count) {
+    if (indices.size() % 3)
+        throw std::runtime_error("Index buffer is not a triangle list");
+
+    const size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0)
+        return;
+
+    //Vertex -> triangle adjacency in compressed row form
+    std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+    for (const auto index : indices) {
+        if (index >= vertex_count)
+            throw std::runtime_error("Index out of range");
+        ++adjacency_offsets[index + 1];
+    }
+    for (size_t i = 0; i < vertex_count; ++i)
+        adjacency_offsets[i + 1] += adjacency_offsets[i];
+
+    std::vector<uint32_t> remaining_triangles(vertex_count);
+    for (size_t i = 0; i < vertex_count; ++i)
+        remaining_triangles[i] = adjacency_offsets[i + 1] - adjacency_offsets[i];
+
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i)
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<int> cache_position(vertex_count, -1);
+    std::vector<float> vertex_scores(vertex_count);
+    for (size_t i = 0; i < vertex_count; ++i)
+        vertex_scores[i] = vertexScore(-1, remaining_triangles[i]);
+
+    std::vector<float> triangle_scores(triangle_count);
+    for (size_t t = 0; t < triangle_count; ++t)
+        triangle_scores[t] = vertex_scores[indices[3 * t + 0]] + vertex_scores[indices[3 * t + 1]] + vertex_scores[indices[3 * t + 2]];
+
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    std::vector<uint32_t> cache;
+    cache.reserve(CACHE_SIZE + 3);
+    std::vector<uint32_t> new_cache;
+    new_cache.reserve(CACHE_SIZE + 3);
+
+    size_t input_cursor = 0;
+    int64_t best_triangle = -1;
+
+    for (size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count) {
+        if (best_triangle < 0) {
+            //No candidate connected to the cache, continue with the next unprocessed triangle.
+            while (emitted[input_cursor])
+                ++input_cursor;
+            best_triangle = static_cast<int64_t>(input_cursor);
+        }
+
+        const uint32_t* triangle = &indices[3 * best_triangle];
+        emitted[best_triangle] = true;
+        output.insert(output.end(), triangle, triangle + 3);
+
+        //Move triangle vertices to the front of the LRU cache and detach the triangle from its vertices.
+        new_cache.clear();
+        for (int k = 0; k < 3; ++k) {
+            const auto v = triangle[k];
+            if (std::find(new_cache.begin(), new_cache.end(), v) == new_cache.end())
+                new_cache.push_back(v);
+
+            auto begin = adjacency.begin() + adjacency_offsets[v];
+            auto end = begin + remaining_triangles[v];
+            std::iter_swap(std::find(begin, end, static_cast<uint32_t>(best_triangle)), end - 1);
+            --remaining_triangles[v];
+        }
+        for (const auto v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                new_cache.push_back(v);
+        }
+
+        //Update scores of the cached vertices and their triangles and pick the best candidate among them.
+        //Vertices that just fell out of the cache get updated as well but aren't kept.
+        best_triangle = -1;
+        float best_score = -1.0f;
+        for (int i = 0; i < new_cache.size(); ++i) {
+            const auto v = new_cache[i];
+            cache_position[v] = i < CACHE_SIZE ? i : -1;
+
+            const float new_score = vertexScore(cache_position[v], remaining_triangles[v]);
+            const float delta = new_score - vertex_scores[v];
+            vertex_scores[v] = new_score;
+
+            for (uint32_t j = 0; j < remaining_triangles[v]; ++j) {
+                const auto t = adjacency[adjacency_offsets[v] + j];
+                triangle_scores[t] += delta;
+                if (triangle_scores[t] > best_score) {
+                    best_score = triangle_scores[t];
+                    best_triangle = t;
+                }
+            }
+        }
+
+        if (new_cache.size() > CACHE_SIZE)
+            new_cache.resize(CACHE_SIZE);
+        std::swap(cache, new_cache);
+    }
+
+    indices = std::move(output);
+}
+
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertex_count) {
+    constexpr uint32_t UNASSIGNED = 0xFFFFFFFF;
+
+    std::vector<uint32_t> remap(vertex_count, UNASSIGNED);
+    uint32_t next = 0;
+    for (auto& index : indices) {
+        if (index >= vertex_count)
+            throw std::runtime_error("Index out of range");
+        if (remap[index] == UNASSIGNED)
+            remap[index] = next++;
+        index = remap[index];
+    }
+
+    for (auto& r : remap) {
+        if (r == UNASSIGNED)
+            r = next++;
+    }
+
+    return remap;
+}
+
+std::vector<char> remapVertexData(const std::vector<char>& data, size_t element_size, const std::vector<uint32_t>& remap) {
+    if (data.size() != remap.size() * element_size)
+        throw std::runtime_error("Vertex data size doesn't match remap table");
+
+    std::vector<char> remapped(data.size());
+    for (size_t i = 0; i < remap.size(); ++i)
+        memcpy(remapped.data() + remap[i] * element_size, data.data() + i * element_size, element_size);
+    return remapped;
+}
+
+namespace {
+    bool verticesEqual(const std::vector<WeldAttribute>& attributes, size_t a, size_t b) {
+        for (const auto& attribute : attributes) {
+            const float* va = attribute.data + a * attribute.components;
+            const float* vb = attribute.data + b * attribute.components;
+            for (int c = 0; c < attribute.components; ++c) {
+                if (std::fabs(va[c] - vb[c]) > attribute.epsilon)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    uint64_t cellKey(int64_t x, int64_t y, int64_t z) {
+        return (static_cast<uint64_t>(x) * 73856093ull) ^ (static_cast<uint64_t>(y) * 19349663ull) ^ (static_cast<uint64_t>(z) * 83492791ull);
+    }
+}
+
+size_t weldVertices(const std::vector<WeldAttribute>& attributes, size_t vertex_count, std::vector<uint32_t>& remap) {
+    if (attributes.empty() || attributes.front().components != 3)
+        throw std::runtime_error("Welding requires a three component position attribute");
+
+    const float* positions = attributes.front().data;
+    const float epsilon = attributes.front().epsilon;
+
+    //Cells are larger than the tolerance so a vertex only has to be compared against neighbouring cells if it lies close to a cell border.
+    float extent = 0.0f;
+    for (size_t i = 0; i < vertex_count * 3; ++i)
+        extent = std::max(extent, std::fabs(positions[i]));
+    const float cell_size = std::max(4.0f * epsilon, std::max(extent, 1.0f) * 1e-6f);
+    const float inverse_cell_size = 1.0f / cell_size;
+
+    //Cell -> first representative, representatives of the same cell are chained through next.
+    constexpr uint32_t NONE = 0xFFFFFFFF;
+    std::unordered_map<uint64_t, uint32_t> cells;
+    cells.reserve(vertex_count);
+    std::vector<uint32_t> next(vertex_count, NONE);
+    std::vector<uint32_t> unique_index(vertex_count, NONE);
+
+    remap.assign(vertex_count, NONE);
+    uint32_t unique_count = 0;
+
+    for (size_t v = 0; v < vertex_count; ++v) {
+        const float* p = positions + 3 * v;
+
+        int64_t cell[3];
+        int64_t range_min[3];
+        int64_t range_max[3];
+        for (int c = 0; c < 3; ++c) {
+            const float scaled = p[c] * inverse_cell_size;
+            cell[c] = static_cast<int64_t>(std::floor(scaled));
+            const float local = p[c] - cell[c] * cell_size;
+            range_min[c] = local < epsilon ? cell[c] - 1 : cell[c];
+            range_max[c] = cell_size - local < epsilon ? cell[c] + 1 : cell[c];
+        }
+
+        uint32_t match = NONE;
+        for (int64_t x = range_min[0]; x <= range_max[0] && match == NONE; ++x) {
+            for (int64_t y = range_min[1]; y <= range_max[1] && match == NONE; ++y) {
+                for (int64_t z = range_min[2]; z <= range_max[2] && match == NONE; ++z) {
+                    auto it = cells.find(cellKey(x, y, z));
+                    if (it == cells.end())
+                        continue;
+                    for (uint32_t candidate = it->second; candidate != NONE; candidate = next[candidate]) {
+                        if (verticesEqual(attributes, v, candidate)) {
+                            match = candidate;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (match != NONE) {
+            remap[v] = unique_index[match];
+            continue;
+        }
+
+        unique_index[v] = unique_count;
+        remap[v] = unique_count++;
+
+        auto [it, inserted] = cells.try_emplace(cellKey(cell[0], cell[1], cell[2]), static_cast<uint32_t>(v));
+        if (!inserted) {
+            next[v] = it->second;
+            it->second = static_cast<uint32_t>(v);
+        }
+    }
+
+    return unique_count;
+}
+
+std::vector<char> compactVertexData(const std::vector<char>& data, size_t element_size, const std::vector<uint32_t>& remap, size_t unique_count) {
+    if (data.size() != remap.size() * element_size)
+        throw std::runtime_error("Vertex data size doesn't match remap table");
+
+    std::vector<char> compacted(unique_count * element_size);
+    std::vector<bool> written(unique_count, false);
+    for (size_t i = 0; i < remap.size(); ++i) {
+        if (written[remap[i]])
+            continue;
+        memcpy(compacted.data() + remap[i] * element_size, data.data() + i * element_size, element_size);
+        written[remap[i]] = true;
+    }
+    return compacted;
+}
+
+namespace {
+    //Symmetric 4x4 error quadric stored as its 10 unique coefficients.
+    struct Quadric {
+        double a2 = 0, ab = 0, ac = 0, ad = 0;
+        double b2 = 0, bc = 0, bd = 0;
+        double c2 = 0, cd = 0;
+        double d2 = 0;
+
+        static Quadric fromPlane(double a, double b, double c, double d, double weight) {
+            Quadric q;
+            q.a2 = a * a * weight; q.ab = a * b * weight; q.ac = a * c * weight; q.ad = a * d * weight;
+            q.b2 = b * b * weight; q.bc = b * c * weight; q.bd = b * d * weight;
+            q.c2 = c * c * weight; q.cd = c * d * weight;
+            q.d2 = d * d * weight;
+            return q;
+        }
+
+        Quadric& operator+=(const Quadric& o) {
+            a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+            b2 += o.b2; bc += o.bc; bd += o.bd;
+            c2 += o.c2; cd += o.cd;
+            d2 += o.d2;
+            return *this;
+        }
+
+        double error(const float* p) const {
+            const double x = p[0], y = p[1], z = p[2];
+            const double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                + c2 * z * z + 2 * cd * z
+                + d2;
+            return std::fabs(e);
+        }
+    };
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        double error;
+    };
+
+    void triangleNormal(const float* a, const float* b, const float* c, double* n) {
+        const double u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        const double v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        n[0] = u[1] * v[2] - u[2] * v[1];
+        n[1] = u[2] * v[0] - u[0] * v[2];
+        n[2] = u[0] * v[1] - u[1] * v[0];
+    }
+
+    //Checks that moving vertex from onto vertex to doesn't flip any of the remaining triangles around from.
+    bool collapseFlipsTriangles(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& adjacency_offsets,
+        const std::vector<uint32_t>& adjacency, const float* positions, uint32_t from, uint32_t to) {
+        for (uint32_t i = adjacency_offsets[from]; i < adjacency_offsets[from + 1]; ++i) {
+            const uint32_t* triangle = &indices[3 * adjacency[i]];
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+                continue; //Triangle collapses
+
+            const float* p[3];
+            const float* q[3];
+            for (int k = 0; k < 3; ++k) {
+                p[k] = positions + 3 * triangle[k];
+                q[k] = triangle[k] == from ? positions + 3 * to : p[k];
+            }
+
+            double n0[3], n1[3];
+            triangleNormal(p[0], p[1], p[2], n0);
+            triangleNormal(q[0], q[1], q[2], n1);
+            if (n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0.0)
+                return true;
+        }
+        return false;
+    }
+}
+
+std::vector<uint32_t> simplifyMesh(const std::vector<uint32_t>& source_indices, const float* positions, size_t vertex_count,
+    size_t target_index_count, float max_error, float* result_error) {
+    std::vector<uint32_t> indices = source_indices;
+    if (indices.size() % 3)
+        throw std::runtime_error("Index buffer is not a triangle list");
+    for (const auto index : indices) {
+        if (index >= vertex_count)
+            throw std::runtime_error("Index out of range");
+    }
+
+    if (indices.empty() || vertex_count == 0) {
+        if (result_error)
+            *result_error = 0.0f;
+        return indices;
+    }
+
+    //Errors are evaluated relative to the mesh extent so max_error is scale independent.
+    float extent = 0.0f;
+    {
+        float min[3] = { positions[0], positions[1], positions[2] };
+        float max[3] = { positions[0], positions[1], positions[2] };
+        for (size_t v = 0; v < vertex_count; ++v) {
+            for (int c = 0; c < 3; ++c) {
+                min[c] = std::min(min[c], positions[3 * v + c]);
+                max[c] = std::max(max[c], positions[3 * v + c]);
+            }
+        }
+        for (int c = 0; c < 3; ++c)
+            extent = std::max(extent, max[c] - min[c]);
+    }
+    const double error_scale = extent > 0.0f ? 1.0 / (static_cast<double>(extent) * extent) : 1.0;
+    const double max_squared_error = static_cast<double>(max_error) * max_error;
+
+    std::vector<Quadric> quadrics(vertex_count);
+    for (size_t t = 0; t < indices.size() / 3; ++t) {
+        const float* a = positions + 3 * indices[3 * t + 0];
+        const float* b = positions + 3 * indices[3 * t + 1];
+        const float* c = positions + 3 * indices[3 * t + 2];
+        double n[3];
+        triangleNormal(a, b, c, n);
+        const double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length <= 0.0)
+            continue;
+        const double area = 0.5 * length;
+        n[0] /= length; n[1] /= length; n[2] /= length;
+        const double d = -(n[0] * a[0] + n[1] * a[1] + n[2] * a[2]);
+        const auto q = Quadric::fromPlane(n[0], n[1], n[2], d, area);
+        for (int k = 0; k < 3; ++k)
+            quadrics[indices[3 * t + k]] += q;
+    }
+
+    std::vector<uint32_t> adjacency_offsets;
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> remap(vertex_count);
+    std::vector<bool> locked(vertex_count);
+    std::vector<bool> touched(vertex_count);
+    std::unordered_map<uint64_t, uint32_t> edge_counts;
+    double current_error = 0.0;
+
+    while (indices.size() > target_index_count) {
+        const size_t triangle_count = indices.size() / 3;
+
+        //Vertex -> triangle adjacency of the current index buffer
+        adjacency_offsets.assign(vertex_count + 1, 0);
+        for (const auto index : indices)
+            ++adjacency_offsets[index + 1];
+        for (size_t i = 0; i < vertex_count; ++i)
+            adjacency_offsets[i + 1] += adjacency_offsets[i];
+        adjacency.resize(indices.size());
+        {
+            std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i)
+                adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        //Edges used by a single triangle are borders. Since attribute seams split vertices, this includes seams.
+        edge_counts.clear();
+        edge_counts.reserve(indices.size());
+        for (size_t t = 0; t < triangle_count; ++t) {
+            for (int k = 0; k < 3; ++k) {
+                const uint64_t a = indices[3 * t + k];
+                const uint64_t b = indices[3 * t + (k + 1) % 3];
+                ++edge_counts[std::min(a, b) << 32 | std::max(a, b)];
+            }
+        }
+        std::fill(locked.begin(), locked.end(), false);
+        for (const auto& [edge, count] : edge_counts) {
+            if (count == 1) {
+                locked[edge >> 32] = true;
+                locked[edge & 0xFFFFFFFF] = true;
+            }
+        }
+
+        collapses.clear();
+        for (const auto& [edge, count] : edge_counts) {
+            const auto a = static_cast<uint32_t>(edge >> 32);
+            const auto b = static_cast<uint32_t>(edge & 0xFFFFFFFF);
+            auto q = quadrics[a];
+            q += quadrics[b];
+
+            Collapse best{ 0, 0, -1.0 };
+            if (!locked[a])
+                best = { a, b, q.error(positions + 3 * b) * error_scale };
+            if (!locked[b]) {
+                const double error = q.error(positions + 3 * a) * error_scale;
+                if (best.error < 0.0 || error < best.error)
+                    best = { b, a, error };
+            }
+            if (best.error >= 0.0 && best.error <= max_squared_error)
+                collapses.push_back(best);
+        }
+        if (collapses.empty())
+            break;
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& c0, const Collapse& c1) { return c0.error < c1.error; });
+
+        //Every collapse removes about two triangles. Only collapse independent edges per pass so quadrics and flip checks stay valid.
+        const size_t collapse_goal = std::max<size_t>((triangle_count - target_index_count / 3) / 2, 1);
+        for (size_t v = 0; v < vertex_count; ++v)
+            remap[v] = static_cast<uint32_t>(v);
+        std::fill(touched.begin(), touched.end(), false);
+
+        size_t collapse_count = 0;
+        for (const auto& collapse : collapses) {
+            if (collapse_count >= collapse_goal)
+                break;
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+            if (collapseFlipsTriangles(indices, adjacency_offsets, adjacency, positions, collapse.from, collapse.to))
+                continue;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            //Neighbours of both vertices change, lock them for the rest of the pass
+            for (const auto vertex : { collapse.from, collapse.to }) {
+                for (uint32_t i = adjacency_offsets[vertex]; i < adjacency_offsets[vertex + 1]; ++i) {
+                    const uint32_t* triangle = &indices[3 * adjacency[i]];
+                    touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+                }
+            }
+            current_error = std::max(current_error, collapse.error);
+            ++collapse_count;
+        }
+        if (collapse_count == 0)
+            break;
+
+        //Apply collapses and drop degenerate triangles
+        size_t write = 0;
+        for (size_t t = 0; t < triangle_count; ++t) {
+            const auto a = remap[indices[3 * t + 0]];
+            const auto b = remap[indices[3 * t + 1]];
+            const auto c = remap[indices[3 * t + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            indices[write++] = a;
+            indices[write++] = b;
+            indices[write++] = c;
+        }
+        indices.resize(write);
+    }
+
+    if (result_error)
+        *result_error = static_cast<float>(std::sqrt(current_error));
+    return indices;
+}
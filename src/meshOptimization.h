@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct VertexCacheStats {
+    //Average cache miss ratio, transformed vertices per triangle.
+    float acmr = 0.0f;
+    //Average transform to vertex ratio, transformed vertices per unique vertex.
+    float atvr = 0.0f;
+};
+
+//Simulates a FIFO post-transform cache of the given size over a triangle list.
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count, int cache_size = 16);
+
+//Reorders the triangles of a triangle list for post-transform cache efficiency (Forsyth, "Linear-Speed Vertex Cache Optimisation").
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertex_count);
+
+//Renumbers vertices in order of first use by the index buffer so vertex fetches become sequential.
+//Rewrites the indices and returns the remap table, remap[old_index] = new_index. Unreferenced vertices are moved to the end.
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertex_count);
+
+//Applies a remap table produced by optimizeVertexFetch to tightly packed vertex data with elements of element_size bytes.
+std::vector<char> remapVertexData(const std::vector<char>& data, size_t element_size, const std::vector<uint32_t>& remap);
+
+//Float view of one vertex attribute stream used for welding. Two vertices are considered equal if all components
+//of all attributes differ by at most epsilon.
+struct WeldAttribute {
+    const float* data = nullptr;
+    int components = 0;
+    float epsilon = 0.0f;
+};
+
+//Merges vertices that are equal within the given tolerances. The first attribute has to be the position, it gets
+//used to build a spatial hash so only nearby vertices are compared. Writes remap[old_index] = new_index and returns
+//the number of unique vertices. The first occurrence of each unique vertex is kept.
+size_t weldVertices(const std::vector<WeldAttribute>& attributes, size_t vertex_count, std::vector<uint32_t>& remap);
+
+//Keeps the first occurrence of every remapped vertex of tightly packed vertex data.
+std::vector<char> compactVertexData(const std::vector<char>& data, size_t element_size, const std::vector<uint32_t>& remap, size_t unique_count);
+
+//Reduces the triangle count of an indexed triangle list with quadric error metric edge collapses (Garland & Heckbert).
+//Vertices are collapsed onto existing vertices so the vertex data stays valid for the returned index buffer.
+//Border and seam vertices are never moved. Stops at target_index_count or when no collapse below max_error
+//(relative to the mesh extent) is left. The resulting error is written to result_error if given.
+std::vector<uint32_t> simplifyMesh(const std::vector<uint32_t>& indices, const float* positions, size_t vertex_count,
+    size_t target_index_count, float max_error, float* result_error = nullptr);
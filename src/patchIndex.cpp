@@ -0,0 +1,231 @@
+#include "patchIndex.h"
+#include "GlacierFormats.h"
+
+#include <QtConcurrent/qtconcurrentrun.h>
+
+#include <algorithm>
+#include <unordered_set>
+
+using namespace GlacierFormats;
+
+namespace {
+    //File system notifications arrive in bursts while an archive is written, they get coalesced.
+    constexpr int UPDATE_DELAY_MS = 250;
+
+    //Patch archives of the directory with size and write time, without their tables.
+    std::map<std::string, PatchArchiveInfo> listPatchArchives(const std::filesystem::path& directory) {
+        std::map<std::string, PatchArchiveInfo> found;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            PatchArchiveInfo info;
+            info.file_name = entry.path().filename().generic_string();
+            if (!entry.is_regular_file(error) || !parsePatchFileName(info.file_name, info.base, info.patch))
+                continue;
+            info.file_size = entry.file_size(error);
+            info.write_time = entry.last_write_time(error);
+            found.emplace(info.file_name, std::move(info));
+        }
+        return found;
+    }
+
+    void readTables(const std::filesystem::path& directory, PatchArchiveInfo& info) {
+        try {
+            auto archive = readRpkgTables(directory / info.file_name);
+            info.ids.reserve(archive.entries.size());
+            for (const auto& entry : archive.entries)
+                info.ids.push_back(entry.id);
+            std::sort(info.ids.begin(), info.ids.end());
+            info.deletion_list = std::move(archive.deletion_list);
+            std::sort(info.deletion_list.begin(), info.deletion_list.end());
+        }
+        catch (const std::exception& e) {
+            //Likely still being written, the next notification triggers another attempt.
+            info.error = e.what();
+        }
+    }
+}
+
+PatchIndex& PatchIndex::instance() {
+    static PatchIndex inst;
+    return inst;
+}
+
+PatchIndex::PatchIndex() : directory(ResourceRepository::instance()->runtime_dir) {
+    updateTimer.setSingleShot(true);
+    updateTimer.setInterval(UPDATE_DELAY_MS);
+    connect(&updateTimer, SIGNAL(timeout()), SLOT(update()));
+    connect(&tableReader, SIGNAL(finished()), SLOT(publish()));
+
+    connect(&watcher, SIGNAL(directoryChanged(const QString&)), SLOT(scheduleUpdate()));
+    connect(&watcher, SIGNAL(fileChanged(const QString&)), SLOT(scheduleUpdate()));
+    watcher.addPath(QString::fromStdString(directory.generic_string()));
+
+    for (const auto& [file_name, info] : listPatchArchives(directory))
+        startupFiles.emplace(file_name, std::make_pair(info.file_size, info.write_time));
+    update();
+}
+
+void PatchIndex::scheduleUpdate() {
+    updateTimer.start();
+}
+
+void PatchIndex::update() {
+    //One read at a time, changes seen meanwhile are picked up once it got published.
+    if (tableReader.isRunning()) {
+        updatePending = true;
+        return;
+    }
+
+    //Archives are only reread if they are new or changed on disk. patches is only replaced on this thread, so it
+    //can be read here without the lock.
+    auto found = listPatchArchives(directory);
+    std::vector<std::string> stale;
+    bool changed = found.size() != patches.size();
+    for (auto& [file_name, info] : found) {
+        const auto known = patches.find(file_name);
+        if (known != patches.end() && known->second.file_size == info.file_size && known->second.write_time == info.write_time) {
+            info = known->second;
+            continue;
+        }
+
+        changed = true;
+        stale.push_back(file_name);
+
+        const auto file_path = QString::fromStdString((directory / file_name).generic_string());
+        if (!watcher.files().contains(file_path))
+            watcher.addPath(file_path);
+    }
+
+    if (!changed)
+        return;
+
+    tableReader.setFuture(QtConcurrent::run([directory = directory, found = std::move(found), stale = std::move(stale)]() mutable {
+        for (const auto& file_name : stale)
+            readTables(directory, found[file_name]);
+        return found;
+    }));
+}
+
+void PatchIndex::publish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        patches = tableReader.result();
+        countOverrides();
+    }
+    emit indexChanged();
+
+    if (updatePending) {
+        updatePending = false;
+        update();
+    }
+}
+
+void PatchIndex::countOverrides() {
+    std::map<std::string, std::unordered_set<uint64_t>> seen;
+    std::vector<PatchArchiveInfo*> ordered;
+    for (auto& [file_name, info] : patches)
+        ordered.push_back(&info);
+    std::sort(ordered.begin(), ordered.end(), [](const auto a, const auto b) { return a->patch < b->patch; });
+
+    for (auto info : ordered) {
+        auto& category = seen[info->base];
+        info->overrides = 0;
+        for (const auto id : info->ids)
+            info->overrides += category.count(id);
+        category.insert(info->ids.begin(), info->ids.end());
+    }
+}
+
+std::vector<PatchArchiveInfo> PatchIndex::archives(const std::string& base) const {
+    std::vector<PatchArchiveInfo> result;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& [file_name, info] : patches) {
+            if (base.empty() || info.base == base)
+                result.push_back(info);
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+        return a.base != b.base ? a.base < b.base : a.patch < b.patch;
+    });
+    return result;
+}
+
+std::filesystem::path PatchIndex::nextPatchPath(const std::string& source_archive_name) const {
+    std::string base;
+    int source_patch = 0;
+    if (!parseArchiveFileName(std::filesystem::path(source_archive_name).filename().generic_string(), base, source_patch))
+        throw std::runtime_error("Invalid archive name");
+
+    int last_patch = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& [file_name, info] : patches) {
+            if (info.base == base)
+                last_patch = std::max(last_patch, info.patch);
+        }
+    }
+
+    return directory / (base + "patch" + std::to_string(last_patch + 1) + ".rpkg");
+}
+
+std::vector<PatchCollision> PatchIndex::collisions(const std::filesystem::path& patch_path, const std::vector<uint64_t>& ids) const {
+    std::vector<PatchCollision> result;
+
+    std::string base;
+    int patch = 0;
+    const auto target_name = patch_path.filename().generic_string();
+    if (!parsePatchFileName(target_name, base, patch))
+        return result;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& [file_name, info] : patches) {
+        if (info.base != base || file_name == target_name)
+            continue;
+
+        std::vector<uint64_t> common;
+        std::set_intersection(ids.begin(), ids.end(), info.ids.begin(), info.ids.end(), std::back_inserter(common));
+        for (const auto id : common)
+            result.push_back({ id, file_name, info.patch > patch, false });
+
+        common.clear();
+        std::set_intersection(ids.begin(), ids.end(), info.deletion_list.begin(), info.deletion_list.end(), std::back_inserter(common));
+        for (const auto id : common)
+            result.push_back({ id, file_name, info.patch > patch, true });
+    }
+    return result;
+}
+
+std::string PatchIndex::owningPatch(const std::filesystem::path& patch_path, uint64_t id, bool& deleted) const {
+    deleted = false;
+    std::string base;
+    int patch = 0;
+    if (!parsePatchFileName(patch_path.filename().generic_string(), base, patch))
+        return "";
+
+    std::string owner;
+    int owner_patch = -1;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& [file_name, info] : patches) {
+        if (info.base != base || info.patch <= owner_patch)
+            continue;
+
+        const bool contains = std::binary_search(info.ids.begin(), info.ids.end(), id);
+        const bool deletes = std::binary_search(info.deletion_list.begin(), info.deletion_list.end(), id);
+        if (!contains && !deletes)
+            continue;
+        owner = file_name;
+        owner_patch = info.patch;
+        deleted = !contains;
+    }
+    return owner;
+}
+
+bool PatchIndex::unchangedSinceStartup(const std::string& file_name) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto startup = startupFiles.find(file_name);
+    const auto current = patches.find(file_name);
+    return startup != startupFiles.end() && current != patches.end() &&
+        startup->second.first == current->second.file_size && startup->second.second == current->second.write_time;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "rpkgMerge.h"
+
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QTimer>
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct PatchArchiveInfo {
+    std::string file_name;
+    std::string base;
+    int patch = 0;
+    //Sorted ids of the resources stored in the archive.
+    std::vector<uint64_t> ids;
+    //Sorted ids of the deletion list.
+    std::vector<uint64_t> deletion_list;
+    //Number of resources that replace a resource of an older patch of the same category.
+    size_t overrides = 0;
+    //Set if the archive tables couldn't be read.
+    std::string error;
+
+    uintmax_t file_size = 0;
+    std::filesystem::file_time_type write_time;
+};
+
+//A resource that is about to be written and is also contained in, or deleted by, another patch of the same category.
+struct PatchCollision {
+    uint64_t id = 0;
+    std::string file_name;
+    //The other patch is loaded after the written one and takes precedence.
+    bool shadows = false;
+    //The other patch deletes the resource instead of replacing it.
+    bool deletes = false;
+};
+
+//Index of the patch archives in the runtime directory. Only the tables of each archive are read. The index follows
+//the directory through file system notifications and only rereads archives whose size or write time changed.
+//Lives on the GUI thread, tables are read on the thread pool and the query functions are thread safe.
+class PatchIndex : public QObject {
+    Q_OBJECT
+
+public:
+    static PatchIndex& instance();
+
+    //Patches of one category ordered by load order, all patches if base is empty.
+    std::vector<PatchArchiveInfo> archives(const std::string& base = "") const;
+
+    //Path of a new patch for the category of the given archive, numbered after all existing patches so it's loaded last.
+    std::filesystem::path nextPatchPath(const std::string& source_archive_name) const;
+
+    //Other patches of the same category that contain or delete any of the ids. ids has to be sorted.
+    std::vector<PatchCollision> collisions(const std::filesystem::path& patch_path, const std::vector<uint64_t>& ids) const;
+
+    //Newest patch of the category of patch_path that contains or deletes the id, empty if none does. deleted is set
+    //if that patch deletes the id.
+    std::string owningPatch(const std::filesystem::path& patch_path, uint64_t id, bool& deleted) const;
+
+    //Whether the patch still has the size and write time it had when the index was created at startup.
+    bool unchangedSinceStartup(const std::string& file_name) const;
+
+signals:
+    void indexChanged();
+
+private:
+    PatchIndex();
+
+    QFileSystemWatcher watcher;
+    QTimer updateTimer;
+    QFutureWatcher<std::map<std::string, PatchArchiveInfo>> tableReader;
+    bool updatePending = false;
+    std::filesystem::path directory;
+
+    //Only replaced on the GUI thread, other threads need the lock.
+    mutable std::mutex mutex;
+    std::map<std::string, PatchArchiveInfo> patches;
+    std::map<std::string, std::pair<uintmax_t, std::filesystem::file_time_type>> startupFiles;
+
+    void countOverrides();
+
+private slots:
+    void scheduleUpdate();
+    void update();
+    void publish();
+};
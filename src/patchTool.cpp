@@ -0,0 +1,188 @@
+#include "patchTool.h"
+#include "Console.h"
+#include "patchIndex.h"
+#include "rpkgMerge.h"
+#include "GlacierFormats.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace GlacierFormats;
+
+PatchToolWidget::PatchToolWidget(QWidget* parent) : QWidget(parent) {
+    QGridLayout* layout = new QGridLayout(this);
+
+    layout->addWidget(new QLabel("Patch archives in the runtime directory, merged in ascending order:", this), 0, 0);
+
+    pbRefresh = new QPushButton("Refresh", this);
+    pbRefresh->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    connect(pbRefresh, SIGNAL(clicked()), SLOT(refreshPatchList()));
+    layout->addWidget(pbRefresh, 0, 1);
+
+    lwPatches = new QListWidget(this);
+    connect(lwPatches, SIGNAL(itemChanged(QListWidgetItem*)), SLOT(selectionChanged()));
+    layout->addWidget(lwPatches, 1, 0, 1, 2);
+
+    outputBrowser = new PathBrowserWidget(PathBrowserType::SAVE_FILE, "Merged Patch File:", "RPKG (*.rpkg)", this);
+    layout->addWidget(outputBrowser, 2, 0, 1, 2);
+
+    cbRemoveMerged = new QCheckBox("Remove merged patches", this);
+    cbRemoveMerged->setToolTip("Deletes the selected patch archives once the merged archive has been written successfully");
+    layout->addWidget(cbRemoveMerged, 3, 0, 1, 2);
+
+    pbMerge = new QPushButton("Merge", this);
+    connect(pbMerge, SIGNAL(clicked()), SLOT(mergePatches()));
+    layout->addWidget(pbMerge, 4, 0, 1, 2);
+
+    mergeJob = new BackgroundJob(this);
+    connect(mergeJob, &BackgroundJob::started, pbMerge, [this]() { pbMerge->setEnabled(false); });
+    connect(mergeJob, &BackgroundJob::finished, pbMerge, [this]() { pbMerge->setEnabled(true); });
+
+    setLayout(layout);
+
+    connect(&PatchIndex::instance(), SIGNAL(indexChanged()), SLOT(refreshPatchList()));
+    refreshPatchList();
+}
+
+//Rebuilds the list from the patch index, which follows the runtime directory. Check states are kept.
+void PatchToolWidget::refreshPatchList() {
+    QSet<QString> checked;
+    for (int i = 0; i < lwPatches->count(); ++i) {
+        if (lwPatches->item(i)->checkState() == Qt::Checked)
+            checked.insert(lwPatches->item(i)->text());
+    }
+
+    QSignalBlocker blocker(lwPatches);
+    lwPatches->clear();
+    for (const auto& patch : PatchIndex::instance().archives()) {
+        const auto file_name = QString::fromStdString(patch.file_name);
+        auto item = new QListWidgetItem(file_name, lwPatches);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(checked.contains(file_name) ? Qt::Checked : Qt::Unchecked);
+        if (patch.error.empty()) {
+            item->setToolTip(QString("%1 resources, %2 overriding older patches, %3 deleted resource ids")
+                .arg(patch.ids.size())
+                .arg(patch.overrides)
+                .arg(patch.deletion_list.size()));
+        }
+        else {
+            item->setToolTip(QString::fromStdString(patch.error));
+        }
+    }
+}
+
+//Suggests the oldest selected patch as output, so the merged archive takes its place in the load order. Selections
+//that skip a patch of the category are rejected by the merge.
+void PatchToolWidget::selectionChanged() {
+    for (int i = 0; i < lwPatches->count(); ++i) {
+        if (lwPatches->item(i)->checkState() != Qt::Checked)
+            continue;
+        const auto path = ResourceRepository::instance()->runtime_dir / lwPatches->item(i)->text().toStdString();
+        outputBrowser->setPath(QString::fromStdString(path.generic_string()));
+        return;
+    }
+}
+
+BackgroundJob* PatchToolWidget::job() const {
+    return mergeJob;
+}
+
+//The selection is collected on the GUI thread, the list keeps following the patch index while the merge runs.
+void PatchToolWidget::mergePatches() {
+    std::vector<std::string> file_names;
+    for (int i = 0; i < lwPatches->count(); ++i) {
+        if (lwPatches->item(i)->checkState() == Qt::Checked)
+            file_names.push_back(lwPatches->item(i)->text().toStdString());
+    }
+    auto outputPath = std::filesystem::path(outputBrowser->path().toStdString());
+    auto removeMerged = cbRemoveMerged->isChecked();
+
+    mergeJob->start([this, file_names, outputPath, removeMerged]() { doMerge(file_names, outputPath, removeMerged); });
+}
+
+void PatchToolWidget::doMerge(const std::vector<std::string>& file_names, const std::filesystem::path& outputPath, bool removeMerged) {
+    const auto runtimeDirectory = ResourceRepository::instance()->runtime_dir;
+
+    std::vector<std::filesystem::path> archives;
+    std::string base;
+    int firstPatch = std::numeric_limits<int>::max();
+    int lastPatch = -1;
+    for (const auto& file_name : file_names) {
+        std::string patch_base;
+        int patch = 0;
+        parsePatchFileName(file_name, patch_base, patch);
+        if (!base.empty() && patch_base != base) {
+            printError("Only patches of the same archive can be merged (" + base + " and " + patch_base + ")");
+            return;
+        }
+        base = patch_base;
+        firstPatch = std::min(firstPatch, patch);
+        lastPatch = std::max(lastPatch, patch);
+        archives.push_back(runtimeDirectory / file_name);
+    }
+
+    if (archives.size() < 2) {
+        printError("Select at least two patch archives to merge");
+        return;
+    }
+
+    if (!isValidSaveFilePath(outputPath)) {
+        printError("Merged patch file path invalid");
+        return;
+    }
+
+    //The merged archive takes a single place in the load order. A patch of the category loaded between the merged ones
+    //or between them and the output would swap precedence with the entries moved across it.
+    std::string outputBase;
+    int outputPatch = 0;
+    std::error_code error;
+    if (std::filesystem::equivalent(outputPath.parent_path(), runtimeDirectory, error) &&
+        parsePatchFileName(outputPath.filename().generic_string(), outputBase, outputPatch) && outputBase == base) {
+        firstPatch = std::min(firstPatch, outputPatch);
+        lastPatch = std::max(lastPatch, outputPatch);
+    }
+    for (const auto& patch : PatchIndex::instance().archives(base)) {
+        if (patch.patch > firstPatch && patch.patch < lastPatch &&
+            std::find(file_names.begin(), file_names.end(), patch.file_name) == file_names.end()) {
+            printError(patch.file_name + " is loaded between the merged patches and the output, include it in the merge or "
+                "choose an output within the selected patches");
+            return;
+        }
+    }
+
+    mergeJob->stage("Merging patches", 0.05f);
+    printStatus("Merging " + std::to_string(archives.size()) + " patch archives into " + outputPath.generic_string() + "...");
+
+    //Written next to the output first, the output may be one of the merged archives.
+    auto temporaryPath = outputPath;
+    temporaryPath += ".merging";
+    try {
+        auto report = mergeRpkgArchives(archives, temporaryPath);
+        std::filesystem::rename(temporaryPath, outputPath);
+
+        //Only once the output is in place, it may have replaced one of the sources.
+        if (removeMerged) {
+            for (const auto& archive : archives) {
+                std::error_code error;
+                if (std::filesystem::equivalent(archive, outputPath, error))
+                    continue;
+                if (!std::filesystem::remove(archive, error) && error)
+                    printWarning("Failed to remove " + archive.generic_string() + ": " + error.message());
+            }
+        }
+
+        printStatus("    " + std::to_string(report.resources) + " resources, " +
+            std::to_string(report.overridden) + " overridden, " +
+            std::to_string(report.deduplicated) + " deduplicated, " +
+            std::to_string(report.deletions) + " deleted resource ids, " +
+            std::to_string(report.bytes_written / 1024) + " KiB written");
+    }
+    catch (const std::exception& e) {
+        std::error_code error;
+        std::filesystem::remove(temporaryPath, error);
+        printError(e.what());
+        return;
+    }
+
+    printStatus("Merged patch archives successfully!\n");
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "backgroundJob.h"
+#include "pathBrowser.h"
+
+#include <QtWidgets>
+
+class PatchToolWidget : public QWidget {
+    Q_OBJECT
+
+public:
+    PatchToolWidget(QWidget* parent = nullptr);
+
+    BackgroundJob* job() const;
+
+private:
+    QListWidget* lwPatches;
+    QPushButton* pbRefresh;
+    PathBrowserWidget* outputBrowser;
+    QCheckBox* cbRemoveMerged;
+    QPushButton* pbMerge;
+    BackgroundJob* mergeJob;
+
+    void doMerge(const std::vector<std::string>& file_names, const std::filesystem::path& outputPath, bool removeMerged);
+
+private slots:
+    void refreshPatchList();
+    void selectionChanged();
+    void mergePatches();
+};
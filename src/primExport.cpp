@@ -1,8 +1,19 @@
 #include "primExport.h"
 #include "Console.h"
+#include "gltfDocument.h"
+#include "gltfFilter.h"
+#include "gltfMerge.h"
+#include "gltfQuantization.h"
+#include "runtimeIdList.h"
+#include "trace.h"
 #include "GlacierFormats.h"
 
-#include <QtConcurrent/qtconcurrentrun.h>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <set>
+#include <unordered_map>
 
 using namespace GlacierFormats;
 
@@ -46,15 +57,286 @@ void PrimExportWidget::updateResourceDependencyTree(const QString& text) {
     tvPrimReferences->expandAll();
 };
 
-void PrimExportWidget::doExport() {
+//Moves all files of the staging directory into directory, replacing existing files of the same name. Every file is
+//copied next to its destination first and only renamed into place once all copies succeeded, so a failed copy leaves
+//the existing files untouched. Returns the normalized destination paths.
+std::vector<std::filesystem::path> installStagedFiles(const std::filesystem::path& staging_path, const std::filesystem::path& directory) {
+    std::vector<std::pair<std::filesystem::path, std::filesystem::path>> copies;
+    try {
+        for (const auto& entry : std::filesystem::directory_iterator(staging_path)) {
+            const auto destination = (directory / entry.path().filename()).lexically_normal();
+            auto temporary = destination;
+            temporary += ".staged";
+            copies.emplace_back(temporary, destination);
+            std::filesystem::copy_file(entry.path(), temporary, std::filesystem::copy_options::overwrite_existing);
+        }
+    }
+    catch (const std::exception&) {
+        std::error_code error;
+        for (const auto& [temporary, destination] : copies)
+            std::filesystem::remove(temporary, error);
+        throw;
+    }
+
+    std::vector<std::filesystem::path> written;
+    for (const auto& [temporary, destination] : copies) {
+        std::filesystem::rename(temporary, destination);
+        written.push_back(destination);
+    }
+    return written;
+}
+
+//Rewrites an exported .gltf and its buffers, optionally filtered, quantized and/or packed into a single .glb.
+//Textures stay external, texture files only used by filtered out meshes get deleted.
+void postProcessGltf(const std::filesystem::path& gltf_path, const std::function<bool(const std::string&)>& keep_mesh, bool quantize, bool pack_glb) {
+    TraceSpan span("Post-process glTF");
+    QTemporaryDir stagingDir;
+    if (!stagingDir.isValid())
+        throw std::runtime_error("Failed to create temporary directory");
+    const auto staging_path = std::filesystem::path(stagingDir.path().toStdString());
+
+    auto output_name = gltf_path.filename();
+    if (pack_glb)
+        output_name.replace_extension(".glb");
+
+    //The document keeps the source files mapped, so outputs are staged and only moved into place once it is released.
+    std::vector<std::filesystem::path> source_files;
+    {
+        GltfDocument document(gltf_path);
+        source_files = document.externalFiles();
+
+        bool modified = false;
+        if (keep_mesh) {
+            auto report = filterGltfMeshes(document, keep_mesh);
+            printStatus("Filtered out " + std::to_string(report.meshes_removed) + " meshes, " +
+                std::to_string(report.materials_removed) + " materials and " +
+                std::to_string(report.removed_images.size()) + " textures");
+            for (const auto& uri : report.removed_images)
+                source_files.push_back(gltf_path.parent_path() / std::filesystem::u8path(QUrl::fromPercentEncoding(QByteArray::fromStdString(uri)).toStdString()));
+            modified = report.meshes_removed > 0;
+        }
+
+        if (quantize) {
+            auto count = quantizeGltf(document);
+            printStatus("Quantized " + std::to_string(count) + " vertex attributes");
+            modified = true;
+        }
+
+        if (modified)
+            document.compact();
 
-    RuntimeId id = cbPrimIds->currentText().toStdString();
+        if (pack_glb)
+            document.saveGlb(staging_path / output_name);
+        else
+            document.saveGltf(staging_path / output_name);
+    }
+
+    //Outputs replace the sources first, sources are only deleted once nothing can fail anymore and only if they
+    //weren't overwritten by an output of the same name.
+    const auto written_files = installStagedFiles(staging_path, gltf_path.parent_path());
+    source_files.push_back(gltf_path);
+    for (const auto& file : source_files) {
+        const auto normalized = file.lexically_normal();
+        if (std::find(written_files.begin(), written_files.end(), normalized) != written_files.end())
+            continue;
+        std::error_code error;
+        if (!std::filesystem::remove(file, error) && error)
+            printWarning("Failed to remove " + file.generic_string() + ": " + error.message());
+    }
+}
+
+struct PrimitiveFilterInfo {
+    uint8_t lod_mask;
+    int material_id;
+};
+using PrimitiveFilterInfos = std::unordered_multimap<std::string, PrimitiveFilterInfo>;
+
+//LOD masks and material ids of the primitives of a PRIM by name. GlacierRenderAsset doesn't expose the PRIM it decodes,
+//so the LOD and material filters need a decode of their own. Only these few values are kept per PRIM for the session,
+//repeated filtered exports of a PRIM don't decode it again.
+std::shared_ptr<const PrimitiveFilterInfos> primitiveFilterInfos(const RuntimeId& prim_id) {
+    static std::mutex mutex;
+    static std::unordered_map<uint64_t, std::shared_ptr<const PrimitiveFilterInfos>> cache;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (auto cached = cache.find(prim_id); cached != cache.end())
+            return cached->second;
+    }
+
+    TraceSpan span("Read PRIM filter info");
+    auto infos = std::make_shared<PrimitiveFilterInfos>();
+    {
+        auto prim = ResourceRepository::instance()->getResource<PRIM>(prim_id);
+        GLACIER_ASSERT_TRUE(prim);
+        for (const auto& primitive : prim->primitives)
+            infos->emplace(primitive->name(), PrimitiveFilterInfo{ primitive->remnant.lod_mask, primitive->materialId() });
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.emplace(prim_id, std::move(infos)).first->second;
+}
+
+//Builds a mesh filter from the LOD, material id and submesh name filters of the export options.
+//Meshes get matched to the primitives of the PRIM by name. Meshes without a matching primitive can't be checked against
+//the LOD and material filters, so they are dropped with a warning if one of those is set. Name filters alone don't need
+//the PRIM. Returns an empty function if nothing is filtered.
+std::function<bool(const std::string&)> buildMeshFilter(const RuntimeId& prim_id, uint8_t lod_mask, const QString& material_ids, const QString& submesh_names) {
+    std::set<int> materials;
+    for (const auto& material_id : material_ids.split(',', Qt::SkipEmptyParts)) {
+        bool valid = false;
+        materials.insert(material_id.trimmed().toInt(&valid));
+        if (!valid)
+            throw std::runtime_error("Invalid material id filter: " + material_id.toStdString());
+    }
+
+    const auto name_pattern = submesh_names.trimmed().toStdString();
+    if (lod_mask == 0xFF && materials.empty() && name_pattern.empty())
+        return {};
+
+    std::regex name_regex;
+    try {
+        name_regex = std::regex(name_pattern.empty() ? ".*" : name_pattern, std::regex::icase);
+    }
+    catch (const std::regex_error& e) {
+        throw std::runtime_error("Invalid submesh name filter: " + std::string(e.what()));
+    }
+
+    if (lod_mask == 0xFF && materials.empty()) {
+        return [name_regex](const std::string& mesh_name) {
+            return std::regex_search(mesh_name, name_regex);
+        };
+    }
+
+    const auto primitives = primitiveFilterInfos(prim_id);
+    return [primitives, lod_mask, materials, name_regex](const std::string& mesh_name) {
+        if (!std::regex_search(mesh_name, name_regex))
+            return false;
+
+        auto [begin, end] = primitives->equal_range(mesh_name);
+        if (begin == end) {
+            printWarning("Mesh " + mesh_name + " doesn't match any primitive of the PRIM, it was removed by the LOD and material filters");
+            return false;
+        }
+
+        for (auto it = begin; it != end; ++it) {
+            const auto& info = it->second;
+            if ((info.lod_mask & lod_mask) && (materials.empty() || materials.count(info.material_id)))
+                return true;
+        }
+        return false;
+    };
+}
+
+struct SceneExportOptions {
+    uint8_t lod_mask = 0xFF;
+    QString material_ids;
+    QString submesh_names;
+    bool export_textures = true;
+    bool quantize = false;
+    bool pack_glb = false;
+};
+
+//Copies the external images the document references from texture_path into export_dir. Returns the number of copied files.
+size_t installReferencedImages(const GltfDocument& document, const std::filesystem::path& texture_path, const std::filesystem::path& export_dir) {
+    std::set<std::string> uris;
+    for (const auto& image : document.json().value("images").toArray()) {
+        const auto uri = image.toObject().value("uri").toString();
+        if (!uri.isEmpty() && !uri.startsWith("data:"))
+            uris.insert(QUrl::fromPercentEncoding(uri.toUtf8()).toStdString());
+    }
+
+    size_t copied = 0;
+    for (const auto& uri : uris) {
+        const auto source = texture_path / std::filesystem::u8path(uri);
+        if (!std::filesystem::exists(source))
+            continue;
+        const auto destination = export_dir / std::filesystem::u8path(uri);
+        std::filesystem::create_directories(destination.parent_path());
+        std::filesystem::copy_file(source, destination, std::filesystem::copy_options::overwrite_existing);
+        ++copied;
+    }
+    return copied;
+}
+
+//Exports several PRIMs into a single <first id>_scene.gltf/.glb. Every PRIM gets exported into a staging directory,
+//filtered and appended to the scene as a root node named after its id. All geometry ends up in one buffer, materials
+//and textures shared between the PRIMs are only stored once. Textures are staged as well, only those the merged scene
+//still references get copied into export_dir.
+void exportScene(const std::vector<RuntimeId>& ids, const std::filesystem::path& export_dir, const SceneExportOptions& options, BackgroundJob& job) {
+    QTemporaryDir stagingDir;
+    if (!stagingDir.isValid())
+        throw std::runtime_error("Failed to create temporary directory");
+    const auto staging_path = std::filesystem::path(stagingDir.path().toStdString());
+    const auto texture_path = staging_path / "textures";
+    std::filesystem::create_directories(texture_path);
+
+    std::unique_ptr<GltfDocument> scene = nullptr;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const auto& id = ids[i];
+        job.stage("Exporting " + QString::fromStdString(id), 0.9f * i / ids.size());
+        printStatus("Exporting " + std::string(id) + ".PRIM...");
+        auto keep_mesh = buildMeshFilter(id, options.lod_mask, options.material_ids, options.submesh_names);
+
+        {
+            TraceSpan render_asset_span("Generate GlacierRenderAsset");
+            GlacierRenderAsset model(id);
+            model.sortMeshes();
+            render_asset_span.end();
+
+            TraceSpan geometry_span("Export geometry", "io");
+            Export::GLTFExporter{}(model, staging_path.generic_string());
+            geometry_span.end();
+
+            if (options.export_textures) {
+                TraceSpan texture_span("Export textures", "io");
+                Export::TGAExporter{}(model, texture_path.generic_string());
+            }
+        }
+
+        auto document = std::make_unique<GltfDocument>(staging_path / (std::string(id) + ".gltf"));
+        if (keep_mesh)
+            filterGltfMeshes(*document, keep_mesh);
+
+        //The first PRIM's document becomes the scene, the others get appended to it.
+        if (!scene) {
+            wrapGltfScene(*document, QString::fromStdString(id));
+            scene = std::move(document);
+        }
+        else {
+            appendGltfScene(*scene, *document, QString::fromStdString(id));
+        }
+    }
+
+    job.stage("Merging scene", 0.9f);
+    printStatus("Merging scene...");
+    if (options.quantize) {
+        auto count = quantizeGltf(*scene);
+        printStatus("Quantized " + std::to_string(count) + " vertex attributes");
+    }
+    scene->compact();
+
+    const auto scene_name = std::string(ids.front()) + "_scene";
+    if (options.pack_glb)
+        scene->saveGlb(export_dir / (scene_name + ".glb"));
+    else
+        scene->saveGltf(export_dir / (scene_name + ".gltf"));
+
+    if (options.export_textures) {
+        TraceSpan texture_span("Install textures", "io");
+        const auto count = installReferencedImages(*scene, texture_path, export_dir);
+        printStatus("Exported " + std::to_string(count) + " textures");
+    }
+}
+
+void PrimExportWidget::doExport(const PrimExportSettings& settings) {
+
+    RuntimeId id = settings.prim_id;
     if (id == 0) {
         printError("Failed to export PRIM: No valid PRIM id");
         return;
     }
 
-    std::filesystem::path export_dir = exportDirectory->path().toStdString();
+    const auto& export_dir = settings.export_dir;
     if (export_dir.empty()) {
         printError("Failed to export PRIM: No destination directory specified");
         return;
@@ -64,18 +346,78 @@ void PrimExportWidget::doExport() {
         " to " + export_dir.generic_string() + std::string(id) + ".gltf\n";
     printStatus(msg);
 
+    TraceSession traceSession(std::string(id) + "_export");
+    TraceSpan exportSpan("Export", "job");
+
+    const auto lod_mask = settings.lod_mask;
+    if (lod_mask == 0) {
+        printError("Failed to export PRIM: No LOD level selected");
+        return;
+    }
+
+    //Additional PRIMs turn the export into a scene export
+    std::vector<RuntimeId> scene_ids{ id };
+    auto scene_id_list = parseRuntimeIds(settings.scene_prim_ids);
+    sortUniqueRuntimeIds(scene_id_list);
+    for (const auto scene_id_value : scene_id_list) {
+        const RuntimeId scene_id(scene_id_value);
+        if (scene_id == id)
+            continue;
+        if (ResourceRepository::instance()->getResourceType(scene_id) != "PRIM") {
+            printError("Failed to export scene: " + std::string(scene_id) + " is not a valid PRIM id");
+            return;
+        }
+        scene_ids.push_back(scene_id);
+    }
+
+    if (scene_ids.size() > 1) {
+        SceneExportOptions options;
+        options.lod_mask = lod_mask;
+        options.material_ids = settings.material_ids;
+        options.submesh_names = settings.submesh_names;
+        options.export_textures = settings.export_textures;
+        options.quantize = settings.quantize;
+        options.pack_glb = settings.pack_glb;
+        try {
+            exportScene(scene_ids, export_dir, options, *exportJob);
+        }
+        catch (const std::exception& e) {
+            printError(std::string(e.what()));
+            return;
+        }
+        printStatus("\nScene of " + std::to_string(scene_ids.size()) + " PRIMs exported successfully!\n");
+        return;
+    }
+
     try {
+        auto keep_mesh = buildMeshFilter(id, lod_mask, settings.material_ids, settings.submesh_names);
+
+        exportJob->stage("Generating GlacierRenderAsset", 0.05f);
         printStatus("Generating GlacierRenderAsset...");
+        TraceSpan renderAssetSpan("Generate GlacierRenderAsset");
         GlacierRenderAsset model(id);
         model.sortMeshes();
+        renderAssetSpan.end();
 
+        exportJob->stage("Exporting geometry", 0.3f);
         printStatus("Exporting Geometry...");
+        TraceSpan geometrySpan("Export geometry", "io");
         Export::GLTFExporter{}(model, export_dir.generic_string());
+        geometrySpan.end();
 
-        if (cbExportTextures->isChecked()) {
+        if (settings.export_textures) {
+            exportJob->stage("Exporting textures", 0.5f);
             printStatus("Exporting Textures...");
+            TraceSpan textureSpan("Export textures", "io");
             Export::TGAExporter{}(model, export_dir.generic_string());
         }
+
+        //Runs after the texture export so textures of filtered out meshes can be removed again.
+        if (keep_mesh || settings.quantize || settings.pack_glb) {
+            exportJob->stage("Post-processing glTF", 0.8f);
+            printStatus("Post-processing glTF...");
+            postProcessGltf(export_dir / (std::string(id) + ".gltf"), keep_mesh, settings.quantize, settings.pack_glb);
+        }
     }
     catch (const std::exception& e) {
         printError(std::string(e.what()));
@@ -85,14 +427,30 @@ void PrimExportWidget::doExport() {
     printStatus("\nPRIM exported successfully!\n");
 }
 
-void PrimExportWidget::exportModel() {
-    emit exportStarted();
-    auto future = QtConcurrent::run(this, &PrimExportWidget::doExport);
-    while (!future.isFinished()) {
-        qApp->processEvents();
-        Sleep(33);
+BackgroundJob* PrimExportWidget::job() const {
+    return exportJob;
+}
+
+PrimExportSettings PrimExportWidget::settings() const {
+    PrimExportSettings settings;
+    settings.prim_id = cbPrimIds->currentText().toStdString();
+    settings.scene_prim_ids = leScenePrimIds->text().toStdString();
+    settings.export_dir = exportDirectory->path().toStdString();
+    for (int i = 0; i < 8; ++i) {
+        if (cbLods[i]->isChecked())
+            settings.lod_mask |= 1 << i;
     }
-    emit exportFinished();
+    settings.material_ids = leMaterialIds->text();
+    settings.submesh_names = leSubmeshNames->text();
+    settings.export_textures = cbExportTextures->isChecked();
+    settings.quantize = cbQuantize->isChecked();
+    settings.pack_glb = cbExportGlb->isChecked();
+    return settings;
+}
+
+void PrimExportWidget::exportModel() {
+    //The widgets are only read here, the export itself runs on a worker thread.
+    exportJob->start([this, export_settings = settings()]() { doExport(export_settings); });
 }
 
 PrimExportWidget::PrimExportWidget(QWidget* parent) : QWidget(parent) {
@@ -140,17 +498,67 @@ PrimExportWidget::PrimExportWidget(QWidget* parent) : QWidget(parent) {
     cbTextureFormat->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
     glOptions->addWidget(cbTextureFormat, 0, 1);
 
+    cbExportGlb = new QCheckBox(this);
+    cbExportGlb->setText("Export as .glb");
+    cbExportGlb->setToolTip("Packs the glTF json and binary buffers into a single binary glTF file");
+    glOptions->addWidget(cbExportGlb, 1, 0);
+
+    cbQuantize = new QCheckBox(this);
+    cbQuantize->setText("Quantize attributes");
+    cbQuantize->setToolTip("Stores normals, tangents, uvs and weights as normalized integers (KHR_mesh_quantization).\nSignificantly reduces the size of the exported buffers.");
+    glOptions->addWidget(cbQuantize, 1, 1);
+
+    glOptions->addWidget(new QLabel("Scene PRIMs:", this), 2, 0);
+    leScenePrimIds = new QLineEdit(this);
+    leScenePrimIds->setPlaceholderText("00d4a4a176a10980, ...");
+    leScenePrimIds->setToolTip("Additional PRIM ids exported together with the selected PRIM into a single <id>_scene.gltf.\nEach PRIM becomes a root node, buffers, materials and textures are shared.");
+    glOptions->addWidget(leScenePrimIds, 2, 1);
+
     QGroupBox* gbOptions = new QGroupBox("Options", this);
     gbOptions->setLayout(glOptions);
 
     exporterLayout->addWidget(gbOptions, 2, 0, 1, 2);
 
+    //Filters
+    QGridLayout* glFilters = new QGridLayout();
+    glFilters->addWidget(new QLabel("LOD levels:", this), 0, 0);
+    QHBoxLayout* hlLods = new QHBoxLayout();
+    for (int i = 0; i < 8; ++i) {
+        cbLods[i] = new QCheckBox(QString::number(i), this);
+        cbLods[i]->setChecked(true);
+        cbLods[i]->setToolTip(QString("Export meshes visible at LOD level %1").arg(i));
+        hlLods->addWidget(cbLods[i]);
+    }
+    hlLods->addStretch();
+    glFilters->addLayout(hlLods, 0, 1);
+
+    glFilters->addWidget(new QLabel("Material ids:", this), 1, 0);
+    leMaterialIds = new QLineEdit(this);
+    leMaterialIds->setPlaceholderText("All");
+    leMaterialIds->setToolTip("Comma separated list of material ids of meshes that should be exported");
+    glFilters->addWidget(leMaterialIds, 1, 1);
+
+    glFilters->addWidget(new QLabel("Submesh names:", this), 2, 0);
+    leSubmeshNames = new QLineEdit(this);
+    leSubmeshNames->setPlaceholderText("All");
+    leSubmeshNames->setToolTip("Regular expression matched against the names of the meshes that should be exported");
+    glFilters->addWidget(leSubmeshNames, 2, 1);
+
+    QGroupBox* gbFilters = new QGroupBox("Filters", this);
+    gbFilters->setLayout(glFilters);
+
+    exporterLayout->addWidget(gbFilters, 3, 0, 1, 2);
+
     exportDirectory = new PathBrowserWidget(PathBrowserType::OPEN_DIRECTORY, "Export directory:", "", this);
-    exporterLayout->addWidget(exportDirectory, 3, 0, 1, 2);
+    exporterLayout->addWidget(exportDirectory, 4, 0, 1, 2);
 
     pbExportModel = new QPushButton("Export", this);
-    exporterLayout->addWidget(pbExportModel, 4, 0, 1, 1);
+    exporterLayout->addWidget(pbExportModel, 5, 0, 1, 1);
     connect(pbExportModel, SIGNAL(clicked()), this, SLOT(exportModel()));
 
+    exportJob = new BackgroundJob(this);
+    connect(exportJob, &BackgroundJob::started, pbExportModel, [this]() { pbExportModel->setEnabled(false); });
+    connect(exportJob, &BackgroundJob::finished, pbExportModel, [this]() { pbExportModel->setEnabled(true); });
+
     setLayout(exporterLayout);
 }
\ No newline at end of file
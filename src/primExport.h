@@ -1,27 +1,51 @@
 #pragma once 
+#include "backgroundJob.h"
 #include "pathBrowser.h"
 
 #include <QtWidgets>
 
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+//Snapshot of the export widgets, taken on the GUI thread when an export starts.
+struct PrimExportSettings {
+    std::string prim_id;
+    //Additional PRIM ids that turn the export into a scene export.
+    std::string scene_prim_ids;
+    std::filesystem::path export_dir;
+    uint8_t lod_mask = 0;
+    QString material_ids;
+    QString submesh_names;
+    bool export_textures = true;
+    bool quantize = false;
+    bool pack_glb = false;
+};
+
 class PrimExportWidget : public QWidget {
     Q_OBJECT
 
 public:
     PrimExportWidget(QWidget* parent = nullptr);
 
-    void doExport();
+    PrimExportSettings settings() const;
+    void doExport(const PrimExportSettings& settings);
+    BackgroundJob* job() const;
 
     QComboBox* cbPrimIds;
     QTreeView* tvPrimReferences;
     QCheckBox* cbExportTextures;
+    QCheckBox* cbExportGlb;
+    QCheckBox* cbQuantize;
+    QLineEdit* leScenePrimIds;
+    QCheckBox* cbLods[8];
+    QLineEdit* leMaterialIds;
+    QLineEdit* leSubmeshNames;
     PathBrowserWidget* exportDirectory;
     QPushButton* pbExportModel;
+    BackgroundJob* exportJob;
 
 public slots:
     void updateResourceDependencyTree(const QString& text);
     void exportModel();
-
-signals:
-    void exportStarted();
-    void exportFinished();
 };
\ No newline at end of file
@@ -1,10 +1,24 @@
 #include "primImport.h"
+#include "gltfDocument.h"
+#include "gltfOptimization.h"
+#include "gltfQuantization.h"
+#include "gltfScanner.h"
+#include "gltfSkinning.h"
+#include "meshNormals.h"
+#include "patchIndex.h"
+#include "processMemory.h"
+#include "resourceHashes.h"
+#include "rigCache.h"
+#include "runtimeIdList.h"
+#include "trace.h"
 #include "GlacierFormats.h"
 
 #include <QtConcurrent/qtconcurrentrun.h>
 
+#include <algorithm>
+#include <bitset>
 #include <filesystem>
-#include <regex>
+#include <map>
 
 using namespace GlacierFormats;
 
@@ -31,23 +45,52 @@ DeletionList::DeletionList(QWidget* parent) :
         "001481248949819, 00d4a4a176a10980, ...",
         parent) {
 
+    pbLoadFile = new QPushButton("Load...", this);
+    pbLoadFile->setToolTip("Adds the runtime ids of a text file or a binary file of 64 bit ids");
+    connect(pbLoadFile, SIGNAL(clicked()), SLOT(loadIdFile()));
+    layout()->addWidget(pbLoadFile);
+
+    pbClearFile = new QPushButton("Clear", this);
+    pbClearFile->setToolTip("Removes the ids loaded from file");
+    pbClearFile->setEnabled(false);
+    connect(pbClearFile, SIGNAL(clicked()), SLOT(clearIdFile()));
+    layout()->addWidget(pbClearFile);
 }
 
-std::vector<uint64_t> DeletionList::deletionList() const {
-    std::vector<uint64_t> ids;
+std::vector<uint64_t> DeletionList::deletionList(size_t* duplicates) const {
+    auto ids = parseRuntimeIds(text().toStdString());
+    ids.insert(ids.end(), fileIds.begin(), fileIds.end());
 
-    auto idList = text().toStdString();
+    const auto removed = sortUniqueRuntimeIds(ids);
+    if (duplicates)
+        *duplicates = removed;
+    return ids;
+}
 
-    std::regex runtimeIdRegex("[0-9a-fA-F]{16}");
+void DeletionList::loadIdFile() {
+    const auto path = QFileDialog::getOpenFileName(this, "Load Runtime Id List", "", "Id lists (*.txt *.bin);;All files (*)");
+    if (path.isEmpty())
+        return;
 
-    std::smatch match;
-    while(std::regex_search(idList, match, runtimeIdRegex)) {
-            auto idString = std::string(match.str());
-            ids.push_back(std::stoll(idString, nullptr, 16));
-            idList = match.suffix();
+    try {
+        fileIds = loadRuntimeIdFile(path.toStdString());
+    }
+    catch (const std::exception& e) {
+        printError(e.what());
+        return;
     }
 
-    return ids;
+    const auto duplicates = sortUniqueRuntimeIds(fileIds);
+    pbClearFile->setEnabled(true);
+    pbClearFile->setText(QString("Clear (%1)").arg(fileIds.size()));
+    printStatus("Loaded " + std::to_string(fileIds.size()) + " disabled resource ids from " + path.toStdString() +
+        (duplicates ? ", " + std::to_string(duplicates) + " duplicates removed" : ""));
+}
+
+void DeletionList::clearIdFile() {
+    fileIds.clear();
+    pbClearFile->setEnabled(false);
+    pbClearFile->setText("Clear");
 }
 
 GltfImportOptions::GltfImportOptions(QWidget* parent) : QGroupBox("Options", parent) {
@@ -87,6 +130,24 @@ GltfImportOptions::GltfImportOptions(QWidget* parent) : QGroupBox("Options", par
     cbAutoOrientNormal->setChecked(true);
     layout->addWidget(cbAutoOrientNormal, 0, 2);
 
+    cbRecalculateNormals = new QCheckBox(this);
+    cbRecalculateNormals->setText("Recalculate normals");
+    cbRecalculateNormals->setToolTip("Replaces the normals of all meshes with smooth, angle weighted normals and generates tangents.\nHard edges are kept where the source normals are split.");
+    layout->addWidget(cbRecalculateNormals, 2, 2);
+
+    cbOptimizeVertexCache = new QCheckBox(this);
+    cbOptimizeVertexCache->setText("Optimize vertex cache");
+    cbOptimizeVertexCache->setToolTip("Reorders triangles and vertices of all meshes for better GPU vertex cache and fetch efficiency");
+    layout->addWidget(cbOptimizeVertexCache, 1, 2);
+
+    cbSkipUnchanged = new QCheckBox(this);
+    cbSkipUnchanged->setText("Skip unchanged resources");
+    cbSkipUnchanged->setToolTip("Leaves resources that are identical to the version already in the game out of the patch. "
+        "Each resource is compared against a decoded copy of the game's version. Textures are re-encoded from the TGA "
+        "files and are not expected to match, so the option rarely skips them.");
+    cbSkipUnchanged->setChecked(false);
+    layout->addWidget(cbSkipUnchanged, 3, 2);
+
     cbUseCustomMaterialId = new QCheckBox(this);
     cbUseCustomMaterialId->setText("Override material Ids");
     cbUseCustomMaterialId->setToolTip("Sets the material id of all meshes to the given id");
@@ -97,6 +158,45 @@ GltfImportOptions::GltfImportOptions(QWidget* parent) : QGroupBox("Options", par
     sbMaterialId->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
     sbMaterialId->setEnabled(false);
     layout->addWidget(sbMaterialId, 3, 1);
+
+    cbWeldVertices = new QCheckBox(this);
+    cbWeldVertices->setText("Weld vertices");
+    cbWeldVertices->setToolTip("Merges duplicate vertices whose attributes are equal within the given tolerances");
+    connect(cbWeldVertices, SIGNAL(stateChanged(int)), SLOT(weldVerticesChecked(int)));
+    layout->addWidget(cbWeldVertices, 4, 0);
+
+    auto weldLayout = new QHBoxLayout();
+    auto addToleranceBox = [this, weldLayout](const QString& label, double value) {
+        weldLayout->addWidget(new QLabel(label, this));
+        auto spinBox = new QDoubleSpinBox(this);
+        spinBox->setDecimals(6);
+        spinBox->setRange(0.0, 1.0);
+        spinBox->setSingleStep(0.00001);
+        spinBox->setValue(value);
+        spinBox->setEnabled(false);
+        weldLayout->addWidget(spinBox);
+        return spinBox;
+    };
+    const WeldTolerances defaultTolerances;
+    sbWeldPosition = addToleranceBox("Position:", defaultTolerances.position);
+    sbWeldNormal = addToleranceBox("Normal:", defaultTolerances.normal);
+    sbWeldUV = addToleranceBox("UV:", defaultTolerances.uv);
+    sbWeldWeight = addToleranceBox("Weight:", defaultTolerances.weight);
+    layout->addLayout(weldLayout, 4, 1, 1, 2);
+
+    cbGenerateLods = new QCheckBox(this);
+    cbGenerateLods->setText("Generate LODs");
+    cbGenerateLods->setToolTip("Generates simplified LOD levels of all meshes. The LOD range of each mesh gets split between its levels");
+    connect(cbGenerateLods, SIGNAL(stateChanged(int)), SLOT(generateLodsChecked(int)));
+    layout->addWidget(cbGenerateLods, 5, 0);
+
+    sbLodLevels = new QSpinBox(this);
+    sbLodLevels->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    sbLodLevels->setRange(2, 8);
+    sbLodLevels->setValue(3);
+    sbLodLevels->setToolTip("Number of LOD levels including the original mesh");
+    sbLodLevels->setEnabled(false);
+    layout->addWidget(sbLodLevels, 5, 1);
 }
 
 void GltfImportOptions::materialIdOverrideChecked(int state) {
@@ -112,6 +212,18 @@ void GltfImportOptions::materialIdOverrideChecked(int state) {
     }
 }
 
+void GltfImportOptions::weldVerticesChecked(int state) {
+    const bool enabled = state == Qt::Checked;
+    sbWeldPosition->setEnabled(enabled);
+    sbWeldNormal->setEnabled(enabled);
+    sbWeldUV->setEnabled(enabled);
+    sbWeldWeight->setEnabled(enabled);
+}
+
+void GltfImportOptions::generateLodsChecked(int state) {
+    sbLodLevels->setEnabled(state == Qt::Checked);
+}
+
 bool GltfImportOptions::importTextures() {
     return cbImportTextures->checkState() == Qt::Checked;
 }
@@ -148,6 +260,39 @@ bool GltfImportOptions::autoOrientNormals() {
     return cbAutoOrientNormal->checkState() == Qt::Checked;
 }
 
+bool GltfImportOptions::recalculateNormals() {
+    return cbRecalculateNormals->checkState() == Qt::Checked;
+}
+
+bool GltfImportOptions::skipUnchangedResources() {
+    return cbSkipUnchanged->checkState() == Qt::Checked;
+}
+
+bool GltfImportOptions::optimizeVertexCache() {
+    return cbOptimizeVertexCache->checkState() == Qt::Checked;
+}
+
+bool GltfImportOptions::weldVertices() {
+    return cbWeldVertices->checkState() == Qt::Checked;
+}
+
+WeldTolerances GltfImportOptions::weldTolerances() {
+    WeldTolerances tolerances;
+    tolerances.position = static_cast<float>(sbWeldPosition->value());
+    tolerances.normal = static_cast<float>(sbWeldNormal->value());
+    tolerances.uv = static_cast<float>(sbWeldUV->value());
+    tolerances.weight = static_cast<float>(sbWeldWeight->value());
+    return tolerances;
+}
+
+bool GltfImportOptions::generateLods() {
+    return cbGenerateLods->checkState() == Qt::Checked;
+}
+
+int GltfImportOptions::lodLevels() {
+    return sbLodLevels->value();
+}
+
 int GltfImportOptions::materialId() {
     return sbMaterialId->value();
 }
@@ -156,8 +301,10 @@ int GltfImportOptions::materialId() {
 GltfImportWidget::GltfImportWidget(QWidget* parent) : QWidget(parent) {
     QGridLayout* importerLayout = new QGridLayout(this);
 
+    importJob = new BackgroundJob(this);
+
     //First line
-    gltfBrowser = new PathBrowserWidget(PathBrowserType::OPEN_FILE, "GLTF File:", "GLTF (*.gltf)", this);
+    gltfBrowser = new PathBrowserWidget(PathBrowserType::OPEN_FILE, "GLTF File:", "GLTF (*.gltf *.glb)", this);
     connect(gltfBrowser, SIGNAL(pathChanged()), SLOT(gltfPathUpdated()));
 
     importerLayout->addWidget(gltfBrowser);
@@ -166,6 +313,7 @@ GltfImportWidget::GltfImportWidget(QWidget* parent) : QWidget(parent) {
     teGltfInfo->setFocusPolicy(Qt::FocusPolicy::NoFocus);
     teGltfInfo->setAttribute(Qt::WA_TransparentForMouseEvents);
     importerLayout->addWidget(teGltfInfo);
+    connect(&infoScanner, SIGNAL(finished()), SLOT(gltfInfoScanned()));
 
     options = new GltfImportOptions(this);
     importerLayout->addWidget(options);
@@ -178,34 +326,53 @@ GltfImportWidget::GltfImportWidget(QWidget* parent) : QWidget(parent) {
 
     pbImport = new QPushButton("Import", this);
     connect(pbImport, SIGNAL(clicked()), SLOT(importGltf()));
+    connect(importJob, &BackgroundJob::started, pbImport, [this]() { pbImport->setEnabled(false); });
+    connect(importJob, &BackgroundJob::finished, pbImport, [this]() { pbImport->setEnabled(true); });
     importerLayout->addWidget(pbImport);
 }
 
-//Takes archive name and returns the next available patch archive file path of the same archive category.
-std::filesystem::path getNextAvailablePatchFileName(const std::string& sourceArchiveName) {
-    auto runtimeDirectory = ResourceRepository::instance()->runtime_dir;
-    
-    std::regex re("(dlc[0-9]{1,2}|chunk[0-9]{1,2})");
-    std::smatch match;
-    std::regex_search(sourceArchiveName, match, re);
-
-    if(match.size() != 2)
-        throw std::runtime_error("Invalid archive name");
-
-    std::string base = match.str(1);
-    std::string patchName = base + "patch1.rpkg";
-    
-    int patchId = 1;
-    while (std::filesystem::exists(runtimeDirectory / patchName)) {
-        patchName = base + "patch" + std::to_string(patchId) + ".rpkg";
-        ++patchId;
+std::string toFixed(double value, int decimals) {
+    return QString::number(value, 'f', decimals).toStdString();
+}
+
+QString describeGltf(const GltfSummary& summary) {
+    QString info;
+    info += QString("Meshes: %1, Accessors: %2, Buffer Views: %3, Nodes: %4, Skins: %5 (%6 joints)\n")
+        .arg(summary.meshes.size())
+        .arg(summary.accessor_counts.size())
+        .arg(summary.buffer_view_count)
+        .arg(summary.node_count)
+        .arg(summary.skin_count)
+        .arg(summary.joint_count);
+
+    for (const auto& mesh : summary.meshes) {
+        info += QString("    %1: %2 vertices, %3 triangles%4\n")
+            .arg(QString::fromUtf8(mesh.name.data(), static_cast<int>(mesh.name.size())))
+            .arg(mesh.vertex_count)
+            .arg(mesh.index_count / 3)
+            .arg(mesh.skinned ? ", skinned" : "");
     }
-    
-    return runtimeDirectory / patchName;
+    return info;
 }
 
 void GltfImportWidget::gltfPathUpdated() {
     auto gltfPath = gltfBrowser->path();
+
+    //Large files take a moment to scan, so the summary is filled in once the scan is done.
+    //Setting a new future drops the result of a scan that is still running for a previous path.
+    teGltfInfo->setPlainText("Scanning " + gltfPath + "...");
+    infoScanner.setFuture(QtConcurrent::run([path = gltfPath.toStdString()]() {
+        GltfInfoScan scan;
+        try {
+            GltfFileSummary summary(path);
+            scan.info = describeGltf(summary.summary());
+        }
+        catch (const std::exception& e) {
+            scan.error = QString::fromStdString(e.what());
+        }
+        return scan;
+    }));
+
     //Generate appropriate patch file name; 
     auto repo = ResourceRepository::instance();
 
@@ -215,19 +382,61 @@ void GltfImportWidget::gltfPathUpdated() {
         return;
     }
 
-    auto patchPath = getNextAvailablePatchFileName(repo->getSourceStreamName(id)).generic_string();
+    try {
+        auto patchPath = PatchIndex::instance().nextPatchPath(repo->getSourceStreamName(id)).generic_string();
+        patchFileBrowser->setPath(QString(patchPath.c_str()));
+    }
+    catch (const std::exception& e) {
+        printError(e.what());
+    }
+}
+
+void GltfImportWidget::gltfInfoScanned() {
+    const auto scan = infoScanner.result();
+    if (scan.error.isEmpty()) {
+        teGltfInfo->setPlainText(scan.info);
+        return;
+    }
+    //The patch path is still set up, the import reports broken files again.
+    teGltfInfo->setPlainText(scan.error);
+    printError(scan.error.toStdString());
+}
+
+BackgroundJob* GltfImportWidget::job() const {
+    return importJob;
+}
 
-    patchFileBrowser->setPath(QString(patchPath.c_str()));
+GltfImportSettings GltfImportWidget::settings() const {
+    GltfImportSettings settings;
+    settings.gltf_path = std::filesystem::path(gltfBrowser->path().toStdString());
+    settings.patch_path = std::filesystem::path(patchFileBrowser->path().toStdString());
+    settings.import_textures = options->importTextures();
+    settings.use_max_lod_range = options->useMaxLODRange();
+    settings.use_custom_material_id = options->useCustomMaterialId();
+    settings.material_id = options->materialId();
+    settings.use_original_bone_info = options->useOriginalBoneInfo();
+    settings.invert_normals_x = options->doInvertNormalsX();
+    settings.invert_normals_y = options->doInvertNormalsY();
+    settings.invert_normals_z = options->doInvertNormalsZ();
+    settings.auto_orient_normals = options->autoOrientNormals();
+    settings.recalculate_normals = options->recalculateNormals();
+    settings.optimize_vertex_cache = options->optimizeVertexCache();
+    settings.skip_unchanged = options->skipUnchangedResources();
+    settings.weld_vertices = options->weldVertices();
+    settings.weld_tolerances = options->weldTolerances();
+    settings.generate_lods = options->generateLods();
+    settings.lod_levels = options->lodLevels();
+    settings.deletion_list = deletionList->deletionList(&settings.duplicate_deletion_ids);
+    return settings;
 }
 
 void GltfImportWidget::importGltf() {
-    emit importStarted();
-    auto future = QtConcurrent::run(this, &GltfImportWidget::doImport);
-    while (!future.isFinished()) {
-        qApp->processEvents();
-        Sleep(33);
-    }
-    emit importFinished();
+    //The widgets are only read here, the import itself runs on a worker thread.
+    importJob->start([this, import_settings = settings()]() {
+        PeakMemoryMeter memory;
+        doImport(import_settings);
+        printStatus(memory.summary());
+    });
 }
 
 std::vector<RuntimeId> getDeepTEXDReferences(uint64_t prim_id) {
@@ -248,137 +457,151 @@ std::vector<RuntimeId> getDeepTEXDReferences(uint64_t prim_id) {
     return texd_ids;
 }
 
-std::vector<std::unique_ptr<Texture>> importTextures(uint64_t prim_id, const std::filesystem::path& texture_folder) {
+//Checks whether a serialized resource is identical to the version the game currently loads for its id, in which case it
+//doesn't need to be part of the patch. The repository was loaded at startup, its version is only compared against if
+//the patch index shows it is still the live one: no patch touched the id since and the archive it came from is
+//unchanged. Resources currently provided by the patch that is about to be overwritten are never considered unchanged,
+//leaving them out would remove them from the game.
+template<typename Resource, typename Buffer>
+bool isUnchangedResource(const RuntimeId& id, const Buffer& data, const std::filesystem::path& patch_path) {
     auto repo = ResourceRepository::instance();
+    if (!repo->contains(id))
+        return false;
+    const auto source = repo->getSourceStreamName(id);
+    if (source == patch_path.filename().generic_string())
+        return false;
+
+    std::string source_base;
+    int source_patch = 0;
+    const bool source_is_patch = parsePatchFileName(source, source_base, source_patch);
+    bool deleted = false;
+    const auto owner = PatchIndex::instance().owningPatch(patch_path, id, deleted);
+    if (deleted || owner != (source_is_patch ? source : std::string()))
+        return false;
+    if (source_is_patch && !PatchIndex::instance().unchangedSinceStartup(source))
+        return false;
+
+    TraceSpan span("Compare with base resource", "kernel");
+    const auto size = data.size() * sizeof(data[0]);
+    span.setBytes(size);
+
+    return BaseResourceHashes::instance().matches<Resource>(id, data.data(), size);
+}
 
-    std::vector<std::unique_ptr<Texture>> textures;
+//Reads a file in small chunks and discards the data, which pulls it into the OS file cache.
+//Only touches its own QFile and buffer and calls nothing in GlacierFormats, so it is safe to run on any thread.
+void readAhead(const std::filesystem::path& path) {
+    TraceSpan span("Read ahead TGA", "io");
+    QFile file(QString::fromStdString(path.generic_string()));
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    std::vector<char> chunk(1 << 20);
+    qint64 total = 0;
+    qint64 read = 0;
+    while ((read = file.read(chunk.data(), chunk.size())) > 0)
+        total += read;
+    span.setBytes(static_cast<size_t>(total));
+}
 
-    auto texd_ids = getDeepTEXDReferences(prim_id);
-    for (const auto& texd_id : texd_ids) {
+//Loads, encodes and serializes the tga textures referenced by the prim one at a time and inserts them into the patch.
+//Only a single decoded texture is alive at any point, so peak memory no longer scales with the number of textures.
+//While a texture is encoded the next tga file is read ahead on a worker thread, so loading it doesn't wait on the disk.
+//Textures identical to the repository version are skipped if skip_unchanged is set, see isUnchangedResource.
+//The ids of all inserted resources are appended to inserted_ids.
+int importTextures(uint64_t prim_id, const std::filesystem::path& texture_folder, RPKG& rpkg, bool skip_unchanged, const std::filesystem::path& patch_path, std::vector<uint64_t>& inserted_ids) {
+    TraceSpan span("Import textures");
+    int imported_count = 0;
+
+    std::vector<std::filesystem::path> texture_paths;
+    for (const auto& texd_id : getDeepTEXDReferences(prim_id)) {
         std::filesystem::path texture_path = texture_folder / (static_cast<std::string>(RuntimeId(texd_id)) + ".tga");//TODO: Hard coded extension :/
         if (texture_path.empty() || !std::filesystem::exists(texture_path) || !std::filesystem::is_regular_file(texture_path))
             continue;
+        texture_paths.push_back(texture_path);
+    }
 
+    QFuture<void> read_ahead;
+    for (size_t i = 0; i < texture_paths.size(); ++i) {
+        const auto& texture_path = texture_paths[i];
+        //Wait for the read of this file, then start on the next one. At most one read ahead is in flight.
+        read_ahead.waitForFinished();
+        if (i + 1 < texture_paths.size())
+            read_ahead = QtConcurrent::run(readAhead, texture_paths[i + 1]);
+
+        std::unique_ptr<Texture> texture = nullptr;
         try {
-            textures.push_back(std::move(Texture::loadFromTGAFile(texture_path)));
+            TraceSpan load_span("Load TGA", "kernel");
+            if (Tracer::instance().enabled()) {
+                std::error_code error;
+                load_span.setBytes(std::filesystem::file_size(texture_path, error));
+            }
+            texture = Texture::loadFromTGAFile(texture_path);
         }
         catch (const std::exception& e) {
             printError(std::string("TGA Texture load failed: ") + e.what());
+            continue;
         }
-    }
-    return textures;
-}
-
-std::vector<float> calculateNormals(const std::vector<unsigned short>& index_buffer, const std::vector<float>& vertex_buffer) {
-    auto normals = std::vector<Vec<float, 3>>(vertex_buffer.size() / 3);
-
-    for (int i = 0; i < index_buffer.size(); i = i + 3) {
-        Vec<float, 3> a, b, c;
-
-        std::vector tri_verts{ index_buffer[i + 0], index_buffer[i + 1], index_buffer[i + 2] };
-
-        a.x() = vertex_buffer[3 * tri_verts[0] + 0];
-        a.y() = vertex_buffer[3 * tri_verts[0] + 1];
-        a.z() = vertex_buffer[3 * tri_verts[0] + 2];
-        b.x() = vertex_buffer[3 * tri_verts[1] + 0];
-        b.y() = vertex_buffer[3 * tri_verts[1] + 1];
-        b.z() = vertex_buffer[3 * tri_verts[1] + 2];
-        c.x() = vertex_buffer[3 * tri_verts[2] + 0];
-        c.y() = vertex_buffer[3 * tri_verts[2] + 1];
-        c.z() = vertex_buffer[3 * tri_verts[2] + 2];
-
-        auto v0 = b - a;
-        auto v1 = c - a;
-        auto n = cross(v0, v1);
-
-        normals[tri_verts[0]] += n;
-        normals[tri_verts[1]] += n;
-        normals[tri_verts[2]] += n;
-    }
-
-    for (auto& normal : normals) {
-        normal.normalize();
-    }
-
-    std::vector<float> new_normals(vertex_buffer.size());//TODO: Maybe don't use Vec<> to avoid the copies..
-    memcpy(new_normals.data(), normals.data(), new_normals.size() * sizeof(float));
+        if (!texture)
+            continue;
 
-    return new_normals;
-}
+        bool inserted = false;
+        if (texture->texd) {
+            TraceSpan serialize_span("Serialize TEXD", "kernel");
+            auto texd_data = texture->texd->serializeToBuffer();
+            serialize_span.setBytes(texd_data.size());
+            serialize_span.end();
+            if (!skip_unchanged || !isUnchangedResource<TEXD>(texture->texd->id, texd_data, patch_path)) {
+                rpkg.insertFile(texture->texd->id, "TEXD", texd_data);
+                inserted_ids.push_back(texture->texd->id);
+                inserted = true;
+            }
+        }
 
-template<>
-struct std::hash<std::array<char, 3>> {
-    std::size_t operator()(const std::array<char, 3>& a) const noexcept {
-        int h = a[2] << 16 | a[1] << 8 | a[0] << 0;
-        return std::hash<int>{}(h);
-    }
-};
-
-std::array<char, 3> findTransformation(const std::vector<float>& normals, const std::vector<float>& reference_normals) {
-    std::unordered_map<std::array<char, 3>, int> occ;
-
-    for (int i = 0; i < normals.size(); i = i + 3) {
-        std::array<char, 3> transform;
-
-        for (int j = 0; j < 3; ++j) {
-            auto v = reference_normals[i + j];
-            auto it = std::min_element(
-                &normals[i],
-                &normals[i] + 3,
-                [v](const float f0, const float f1) {return std::fabs(std::fabs(f0) - std::fabs(v)) < std::fabs(std::fabs(f1) - std::fabs(v)); }
-            );
-            auto offset = std::distance(&normals[i], it);
-            transform[j] = (signbit(v) == signbit(normals[i + j])) ? (offset + 1) : -(offset + 1);
+        if (texture->text) {
+            TraceSpan serialize_span("Serialize TEXT", "kernel");
+            auto text_data = texture->text->serializeToBuffer();
+            serialize_span.setBytes(text_data.size());
+            serialize_span.end();
+            if (!skip_unchanged || !isUnchangedResource<TEXT>(texture->text->id, text_data, patch_path)) {
+                rpkg.insertFile(texture->text->id, "TEXT", text_data);
+                inserted_ids.push_back(texture->text->id);
+                inserted = true;
+            }
         }
 
-        if (occ.find(transform) == occ.end())
-            occ[transform] = 0;
-        occ[transform]++;
-       
+        if (!inserted)
+            printStatus("    " + texture_path.filename().generic_string() + " is unchanged, skipped");
+        else
+            ++imported_count;
     }
-
-    auto it = std::max_element(occ.begin(), occ.end(), 
-        [](const std::pair<std::array<char, 3>, int>& it0,
-            const std::pair<std::array<char, 3>, int>& it1) { return it0.second < it1.second; }
-        );
-
-    return it->first;
+    read_ahead.waitForFinished();
+    return imported_count;
 }
 
-//This functions will attempt to rotate and reflect the normal vectors into the orientation that matches the mesh.
-void reorientNormals(const std::vector<unsigned short>& index_buffer, const std::vector<float>& vertex_buffer, std::vector<float>& normals) {
-    auto reference_normals = calculateNormals(index_buffer, vertex_buffer);
-
-    auto trans = findTransformation(normals, reference_normals);
-
-    for (int i = 0; i < normals.size() / 3; ++i) {
-        std::vector<float> new_normal(3, 0);
-        for (int j = 0; j < 3; ++j) {
-            new_normal[j] = normals[3 * i + std::abs(trans[j]) - 1];
-            if (std::signbit((float)trans[j]))
-                new_normal[j] *= -1.0;
-        }
-
-        for (int j = 0; j < 3; ++j)
-            normals[3 * i + j] = new_normal[j];
+void reportPatchCollisions(const std::vector<PatchCollision>& collisions) {
+    std::map<std::string, std::vector<const PatchCollision*>> by_patch;
+    for (const auto& collision : collisions)
+        by_patch[collision.file_name].push_back(&collision);
+
+    for (const auto& [file_name, patch_collisions] : by_patch) {
+        const auto shadows = patch_collisions.front()->shadows;
+        printWarning(file_name + " is loaded " + (shadows ? "after" : "before") + " this patch and " +
+            (shadows ? "takes precedence over " : "gets overridden for ") + std::to_string(patch_collisions.size()) + " resources:");
+        for (const auto collision : patch_collisions)
+            printStatus("    " + std::string(RuntimeId(collision->id)) + (collision->deletes ? " (deleted)" : ""));
     }
-
-
 }
 
-
-
-
-void GltfImportWidget::doImport() {
+void GltfImportWidget::doImport(const GltfImportSettings& settings) {
     auto repo = ResourceRepository::instance();
 
-    auto gltfFilePath = std::filesystem::path(gltfBrowser->path().toStdString());
+    const auto& gltfFilePath = settings.gltf_path;
     if (!isValidOpenFilePath(gltfFilePath)) {
         printError("Gltf file path invalid");
         return;
     }
 
-    auto patchFilePath = std::filesystem::path(patchFileBrowser->path().toStdString());
+    const auto& patchFilePath = settings.patch_path;
     if (!isValidSaveFilePath(patchFilePath)) {
         printError("Patch file path invalid");
         return;
@@ -392,17 +615,180 @@ void GltfImportWidget::doImport() {
 
     printStatus("GLTF Import:\n    " + gltfFilePath.generic_string() + "\n        ->\n    " + patchFilePath.generic_string() + "\n");
 
+    TraceSession traceSession(std::string(prim_id) + "_import");
+    TraceSpan importSpan("Import", "job");
+
     auto borgReferences = repo->getResourceReferences(prim_id, "BORG");
     GLACIER_ASSERT_TRUE(borgReferences.size() <= 1);
+    std::shared_ptr<BoneMapping> boneMapping = nullptr;
+    if (borgReferences.size()) {//weighted/linked PRIM
+        try {
+            boneMapping = RigCache::instance().boneMapping(borgReferences.front().id);
+        }
+        catch (const std::exception& e) {
+            printError(e.what());
+            return;
+        }
+    }
+
+    importJob->stage("Parsing original PRIM", 0.05f);
+    printStatus("Parsing original PRIM...");
+    std::unique_ptr<PRIM> originalPrim = nullptr;
+    try {
+        TraceSpan span("Parse original PRIM");
+        originalPrim = repo->getResource<GlacierFormats::PRIM>(prim_id);
+        GLACIER_ASSERT_TRUE(originalPrim);
+    }
+    catch (const std::exception& e) {
+        printError(e.what());
+        return;
+    }
+
+    //Generated LOD meshes, mapped to their level, level count and the lod mask range that gets split between the levels.
+    struct LodAssignment {
+        int level = 0;
+        int level_count = 1;
+        uint8_t lod_mask = 0xFF;
+    };
+    std::unordered_map<std::string, LodAssignment> lodAssignments;
+    //Number of imported submeshes that take over the bone and collision buffers of each original submesh name.
+    std::unordered_map<std::string, int> bufferTransfers;
+
+    importJob->stage("Preparing glTF", 0.1f);
+
+    //GLTFAsset only reads plain, float based .gltf files. Binary containers and quantized files get rewritten
+    //into a temporary directory first. Textures are still picked up from the directory of the original file.
+    QTemporaryDir stagingDir;
+    auto gltfAssetPath = gltfFilePath;
+    try {
+        TraceSpan span("Prepare glTF");
+        GltfDocument document(gltfFilePath);
+        //Rejects empty files before the expensive GLTFAsset build.
+        if (document.json().value("meshes").toArray().isEmpty())
+            throw std::runtime_error("Gltf file doesn't contain any meshes");
+
+        bool modified = false;
+        if (auto count = dequantizeGltf(document)) {
+            printStatus("Dequantized " + std::to_string(count) + " vertex attributes");
+            modified = true;
+        }
+
+        //Limits influences to what weighted PRIMs support and drops joints missing from the rig before the weights
+        //take part in welding.
+        if (boneMapping) {
+            printStatus("Processing skin weights...");
+            auto bone_index = [&boneMapping](const std::string& name) -> int {
+                auto bone = boneMapping->find(name);
+                return bone != boneMapping->end() ? static_cast<int>(bone->second) : -1;
+            };
+            //The processed weights only replace the file's if a vertex actually changed.
+            for (const auto& report : processGltfSkinWeights(document, bone_index)) {
+                const auto& stats = report.stats;
+                if (stats.truncated || stats.unmapped || stats.merged || stats.unweighted || stats.renormalized) {
+                    printStatus("    " + report.mesh_name + "[" + std::to_string(report.primitive) + "]: " +
+                        std::to_string(stats.truncated) + " vertices limited to " + std::to_string(MAX_BONE_INFLUENCES) + " influences, " +
+                        std::to_string(stats.unmapped) + " influences of unknown bones dropped, " +
+                        std::to_string(stats.merged) + " influences merged, " +
+                        std::to_string(stats.unweighted) + " vertices without weights, " +
+                        std::to_string(stats.renormalized) + " vertices renormalized");
+                    modified = true;
+                }
+            }
+        }
+
+        //Welding runs first so the cache optimization sees the final vertex set.
+        if (settings.weld_vertices) {
+            printStatus("Welding vertices...");
+            size_t saved = 0;
+            for (const auto& report : weldGltfVertices(document, settings.weld_tolerances)) {
+                printStatus("    " + report.mesh_name + "[" + std::to_string(report.primitive) + "]: " +
+                    std::to_string(report.vertices_before) + " -> " + std::to_string(report.vertices_after) + " vertices");
+                saved += report.vertices_before - report.vertices_after;
+            }
+            printStatus("Welding saved " + std::to_string(saved) + " vertices");
+            modified = true;
+        }
+
+        //Runs after welding so seams are detected on the final vertex set, and before LOD generation since LODs
+        //share the vertex data of their source mesh.
+        if (settings.recalculate_normals) {
+            printStatus("Recalculating normals and tangents...");
+            size_t vertices = 0;
+            for (const auto& report : recalculateGltfNormals(document, true))
+                vertices += report.vertices;
+            printStatus("Recalculated normals of " + std::to_string(vertices) + " vertices");
+            modified = true;
+        }
+
+        //LODs are generated before the cache optimization so every level gets optimized as well.
+        if (settings.generate_lods) {
+            printStatus("Generating LODs...");
+            //Original masks by submesh name, the last submesh of a name wins.
+            std::unordered_map<std::string, uint8_t> originalLodMasks;
+            if (!settings.use_max_lod_range) {
+                for (const auto& primitive : originalPrim->primitives)
+                    originalLodMasks[primitive->name()] = primitive->remnant.lod_mask;
+            }
+
+            std::unordered_map<std::string, uint8_t> lodMasks;
+            std::unordered_map<std::string, int> levelCounts;
+            for (const auto& mesh : document.json().value("meshes").toArray()) {
+                const auto name = mesh.toObject().value("name").toString().toStdString();
+                const auto original = originalLodMasks.find(name);
+                const uint8_t lod_mask = original != originalLodMasks.end() ? original->second : 0xFF;
+                lodMasks[name] = lod_mask;
+                levelCounts[name] = std::min(settings.lod_levels, static_cast<int>(std::bitset<8>(lod_mask).count()));
+            }
+
+            for (const auto& report : generateGltfLods(document, levelCounts)) {
+                printStatus("    " + report.mesh_name + ": LOD " + std::to_string(report.level) + "/" + std::to_string(report.level_count - 1) +
+                    ", " + std::to_string(report.triangles) + " triangles, " + std::to_string(report.vertices) + " vertices, error " + toFixed(report.error, 5));
+
+                LodAssignment assignment;
+                assignment.level = report.level;
+                assignment.level_count = report.level_count;
+                assignment.lod_mask = lodMasks[lodBaseName(report.mesh_name)];
+                lodAssignments[report.mesh_name] = assignment;
+            }
+            modified = true;
+        }
+
+        if (settings.optimize_vertex_cache) {
+            printStatus("Optimizing vertex cache...");
+            for (const auto& report : optimizeGltfVertexCache(document)) {
+                printStatus("    " + report.mesh_name + "[" + std::to_string(report.primitive) + "]: ACMR " +
+                    toFixed(report.before.acmr, 3) + " -> " + toFixed(report.after.acmr, 3) + ", ATVR " +
+                    toFixed(report.before.atvr, 3) + " -> " + toFixed(report.after.atvr, 3) +
+                    (report.vertices_reordered ? "" : " (shared vertices, order kept)"));
+            }
+            modified = true;
+        }
+
+        for (const auto& primitive : document.primitives()) {
+            auto lod = lodAssignments.find(primitive.mesh_name);
+            if (lod == lodAssignments.end() || lod->second.level == 0)
+                ++bufferTransfers[primitive.mesh_name];
+        }
+
+        if (modified || isGlbFile(gltfFilePath)) {
+            if (!stagingDir.isValid())
+                throw std::runtime_error("Failed to create temporary directory");
+            gltfAssetPath = std::filesystem::path(stagingDir.path().toStdString()) / (gltfFilePath.stem().generic_string() + ".gltf");
+            document.saveGltf(gltfAssetPath);
+        }
+    }
+    catch (const std::exception& e) {
+        printError(e.what());
+        return;
+    }
 
+    importJob->stage("Building GLTFAsset", 0.35f);
     printStatus("Building GLTFAsset...");
     std::unique_ptr<GLTFAsset> asset = nullptr;
-    if (borgReferences.size()) {//weighted/linked PRIM
-        auto borg = repo->getResource<BORG>(borgReferences.front().id);
-        GLACIER_ASSERT_TRUE(borg);
-        auto bone_mapping = borg->getNameToBoneIndexMap();
+    if (boneMapping) {//weighted/linked PRIM
         try {
-            asset = std::make_unique<GLTFAsset>(gltfFilePath, &bone_mapping);
+            TraceSpan span("Build GLTFAsset");
+            asset = std::make_unique<GLTFAsset>(gltfAssetPath, boneMapping.get());
             GLACIER_ASSERT_TRUE(asset);
         }
         catch (const std::exception& e) {
@@ -412,7 +798,8 @@ void GltfImportWidget::doImport() {
     }
     else {//standard PRIM
         try {
-            asset = std::make_unique<GLTFAsset>(gltfFilePath);
+            TraceSpan span("Build GLTFAsset");
+            asset = std::make_unique<GLTFAsset>(gltfAssetPath);
             GLACIER_ASSERT_TRUE(asset);
         }
         catch (const std::exception& e) {
@@ -421,48 +808,108 @@ void GltfImportWidget::doImport() {
         }
     }
 
-    printStatus("Parsing original PRIM...");
-    std::unique_ptr<PRIM> originalPrim = nullptr;
-    try {
-        originalPrim = repo->getResource<GlacierFormats::PRIM>(prim_id);
-        GLACIER_ASSERT_TRUE(originalPrim);
-    }
-    catch (const std::exception& e) {
-        printError(e.what());
-        return;
-    }
-
+    importJob->stage("Building PRIM", 0.5f);
     printStatus("Building new PRIM from GLTFAsset...");
 
 
-    auto boneInfoTransferEnabled = options->useOriginalBoneInfo();
+    //Index of the original primitives by name, built once so matching a submesh doesn't rescan the PRIM.
+    //Duplicate names resolve to the last primitive of that name like before.
+    struct OriginalPrimitive {
+        size_t index = 0;
+        int remaining_transfers = 1;
+        int matches = 0;
+    };
+    std::unordered_map<std::string, OriginalPrimitive> originalPrimitives;
+    std::vector<std::string> duplicateNames;
+    for (size_t i = 0; i < originalPrim->primitives.size(); ++i) {
+        const auto name = originalPrim->primitives[i]->name();
+        auto [original, inserted] = originalPrimitives.try_emplace(name);
+        if (!inserted)
+            duplicateNames.push_back(name);
+        original->second.index = i;
+        if (auto transfers = bufferTransfers.find(name); transfers != bufferTransfers.end())
+            original->second.remaining_transfers = transfers->second;
+    }
+
+    std::vector<std::string> unmatchedSubmeshes;
+    std::vector<std::string> exhaustedSubmeshes;
+    auto boneInfoTransferEnabled = settings.use_original_bone_info;
     std::function<void(ZRenderPrimitiveBuilder&, const std::string&)> build_modifier =
-        [repo, prim_id, &originalPrim, boneInfoTransferEnabled](GlacierFormats::ZRenderPrimitiveBuilder& builder, const std::string& submesh_name) -> void {
-        for (auto& primitive : originalPrim->primitives) {
-            auto primitive_name = primitive->name();
-            if (primitive_name == submesh_name) {
-                builder.setMaterialId(primitive->materialId());
-                builder.setLodMask(primitive->remnant.lod_mask);
-                builder.setPropertyFlags(primitive->remnant.submesh_properties);
-                builder.setColor1(primitive->remnant.submesh_color1);
-                builder.setMeshSubtype(primitive->remnant.mesh_subtype);
-                if (boneInfoTransferEnabled) {
-                    builder.setBoneIndices(std::move(primitive->bone_indices));
-                    builder.setBoneInfo(std::move(primitive->bone_info));
-                }
-                builder.setCollisionBuffer(std::move(primitive->collision_data));
+        [&originalPrim, &originalPrimitives, &lodAssignments, &unmatchedSubmeshes, &exhaustedSubmeshes, boneInfoTransferEnabled](GlacierFormats::ZRenderPrimitiveBuilder& builder, const std::string& submesh_name) -> void {
+        //Generated LOD levels take over the properties of their source mesh, but not its bone and collision data.
+        auto original_name = submesh_name;
+        bool generated_lod = false;
+        if (auto lod = lodAssignments.find(submesh_name); lod != lodAssignments.end()) {
+            original_name = lodBaseName(submesh_name);
+            generated_lod = lod->second.level > 0;
+        }
+
+        auto original = originalPrimitives.find(original_name);
+        if (original == originalPrimitives.end()) {
+            unmatchedSubmeshes.push_back(submesh_name);
+            return;
+        }
+        ++original->second.matches;
+
+        auto& primitive = originalPrim->primitives[original->second.index];
+        builder.setMaterialId(primitive->materialId());
+        builder.setLodMask(primitive->remnant.lod_mask);
+        builder.setPropertyFlags(primitive->remnant.submesh_properties);
+        builder.setColor1(primitive->remnant.submesh_color1);
+        builder.setMeshSubtype(primitive->remnant.mesh_subtype);
+        if (generated_lod)
+            return;
+
+        //The builder takes ownership of the buffers. They are copied for all but the last submesh expected to use
+        //them and moved into the last one, so submeshes sharing a name no longer end up with empty buffers.
+        auto& remaining_transfers = original->second.remaining_transfers;
+        if (remaining_transfers <= 0) {
+            exhaustedSubmeshes.push_back(submesh_name);
+            return;
+        }
+
+        if (--remaining_transfers > 0) {
+            if (boneInfoTransferEnabled) {
+                auto bone_indices = primitive->bone_indices;
+                auto bone_info = primitive->bone_info;
+                builder.setBoneIndices(std::move(bone_indices));
+                builder.setBoneInfo(std::move(bone_info));
             }
+            auto collision_data = primitive->collision_data;
+            builder.setCollisionBuffer(std::move(collision_data));
+        }
+        else {
+            if (boneInfoTransferEnabled) {
+                builder.setBoneIndices(std::move(primitive->bone_indices));
+                builder.setBoneInfo(std::move(primitive->bone_info));
+            }
+            builder.setCollisionBuffer(std::move(primitive->collision_data));
         }
     };
 
     std::unique_ptr<PRIM> prim = nullptr;
     try {
+        TraceSpan span("Build PRIM");
         prim = std::make_unique<PRIM>(asset->meshes(), prim_id, &build_modifier);
     }
     catch (const std::exception& e) {
         printError(e.what());
         return;
     }
+    //The asset is fully consumed by the PRIM build.
+    asset.reset();
+
+    //Submesh matching report
+    for (const auto& name : duplicateNames)
+        printWarning("Original PRIM contains multiple submeshes named \"" + name + "\", only the last one is used");
+    for (const auto& name : unmatchedSubmeshes)
+        printWarning("Submesh \"" + name + "\" doesn't match any submesh of the original PRIM, default properties are used");
+    for (const auto& name : exhaustedSubmeshes)
+        printWarning("Submesh \"" + name + "\" shares its name with more submeshes than expected, bone and collision data weren't transferred");
+    for (const auto& [name, original] : originalPrimitives) {
+        if (original.matches == 0)
+            printWarning("Original submesh \"" + name + "\" isn't part of the imported gltf");
+    }
 
     //Post-process primitives
     if (borgReferences.size())//weighted/linked PRIM
@@ -471,75 +918,84 @@ void GltfImportWidget::doImport() {
         prim->manifest.rig_index = -1;
     prim->manifest.properties = originalPrim->manifest.properties;
 
-    int prim_idx = 0;
+    //Everything needed from the original PRIM has been taken over, its buffers can go before serialization.
+    originalPrimitives.clear();
+    originalPrim.reset();
+
+    TraceSpan postProcessSpan("Post-process primitives");
+    const bool invertNormalsX = settings.invert_normals_x;
+    const bool invertNormalsY = settings.invert_normals_y;
+    const bool invertNormalsZ = settings.invert_normals_z;
+    const bool autoOrientNormals = settings.auto_orient_normals;
     for (auto& primitive : prim->primitives) {
-        if (options->useMaxLODRange())
+        if (settings.use_max_lod_range)
             primitive->remnant.lod_mask = 0xFF;
-        if (options->useCustomMaterialId())
-            primitive->remnant.material_id = options->materialId();
-
-        auto invX = options->doInvertNormalsX();
-        auto invY = options->doInvertNormalsY();
-        auto invZ = options->doInvertNormalsZ();
+        if (auto lod = lodAssignments.find(primitive->name()); lod != lodAssignments.end())
+            primitive->remnant.lod_mask = lodMaskRange(lod->second.lod_mask, lod->second.level, lod->second.level_count);
+        if (settings.use_custom_material_id)
+            primitive->remnant.material_id = settings.material_id;
 
+        //Only one primitive's normals are copied out at a time, they are converted in place and handed back.
         auto normals = primitive->getNormals();
-        for (int i = 0; i < normals.size(); i += 3) {
-            auto x = normals[i + 0];
-            auto y = normals[i + 1];
-            auto z = normals[i + 2];
-
-            if (invX)
-                x = -x;
-            if (invY)
-                y = -y;
-            if (invZ)
-                z = -z;
-
-            normals[i + 0] = x;
-            normals[i + 1] = -z;
-            normals[i + 2] = y;
-        }
+        convertNormals(normals, invertNormalsX, invertNormalsY, invertNormalsZ);
 
-        if(options->autoOrientNormals())
+        if (autoOrientNormals)
             reorientNormals(primitive->getIndexBuffer(), primitive->getVertexBuffer(), normals);
 
-        primitive->setNormals(normals);
+        primitive->setNormals(std::move(normals));
     }
+    postProcessSpan.end();
 
     printStatus("Serializing PRIM to patch file...");
     GlacierFormats::RPKG rpkg{};
 
-    auto prim_data = prim->serializeToBuffer();
-    auto refs = repo->getResourceReferences(prim_id);
-    rpkg.insertFile(prim_id, "PRIM", prim_data, &refs);
-
-    printStatus("Importing and serializing textures...");
-    if (options->importTextures()) {
-        auto textures = importTextures(prim_id, gltfFilePath.parent_path());
-        for (const auto& texture : textures) {
-            if (!texture)
-                continue;
-
-            if (texture->texd) {
-                auto texd_data = texture->texd->serializeToBuffer();
-                rpkg.insertFile(texture->texd->id, "TEXD", texd_data);
-            }
-
-            if (texture->text) {
-                auto text_data = texture->text->serializeToBuffer();
-                rpkg.insertFile(texture->text->id, "TEXT", text_data);
-            }
+    std::vector<uint64_t> inserted_ids;
+    {
+        TraceSpan serializeSpan("Serialize PRIM");
+        auto prim_data = prim->serializeToBuffer();
+        serializeSpan.setBytes(prim_data.size());
+        serializeSpan.end();
+        //Only the serialized copy is needed from here on, it is released as soon as the patch has its own.
+        prim.reset();
+
+        if (settings.skip_unchanged && isUnchangedResource<PRIM>(prim_id, prim_data, patchFilePath)) {
+            printStatus("PRIM is unchanged, skipped");
+        }
+        else {
+            auto refs = repo->getResourceReferences(prim_id);
+            rpkg.insertFile(prim_id, "PRIM", prim_data, &refs);
+            inserted_ids.push_back(prim_id);
         }
     }
 
+    importJob->stage("Importing textures", 0.7f);
+    printStatus("Importing and serializing textures...");
+    if (settings.import_textures)
+        importTextures(prim_id, gltfFilePath.parent_path(), rpkg, settings.skip_unchanged, patchFilePath, inserted_ids);
+
     //Deletion list
-    auto deleted_resource_ids = deletionList->deletionList();
+    const auto& deleted_resource_ids = settings.deletion_list;
+    if (settings.duplicate_deletion_ids)
+        printStatus("Removed " + std::to_string(settings.duplicate_deletion_ids) + " duplicate disabled resource ids");
+    const auto unknown_ids = std::count_if(deleted_resource_ids.begin(), deleted_resource_ids.end(), [&repo](uint64_t id) { return !repo->contains(RuntimeId(id)); });
+    if (unknown_ids)
+        printWarning(std::to_string(unknown_ids) + " disabled resource ids aren't part of the resource repository");
     for (const auto& id : deleted_resource_ids)
         rpkg.deletion_list.push_back(id);
 
+    //Other patches of the same archive that touch the written resources decide which version the game loads.
+    std::sort(inserted_ids.begin(), inserted_ids.end());
+    reportPatchCollisions(PatchIndex::instance().collisions(patchFilePath, inserted_ids));
+
+    importJob->stage("Writing patch file", 0.9f);
     printStatus("Writing patch file...");
     try {
+        TraceSpan span("Write patch file", "io");
         rpkg.write(patchFilePath);
+        if (Tracer::instance().enabled()) {
+            std::error_code error;
+            span.setBytes(std::filesystem::file_size(patchFilePath, error));
+        }
     }
     catch (const std::exception& e) {
         printError(e.what());
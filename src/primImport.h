@@ -1,7 +1,10 @@
 #pragma once
+#include "backgroundJob.h"
 #include "pathBrowser.h"
 #include "Console.h"
+#include "gltfOptimization.h"
 
+#include <QFutureWatcher>
 #include <QtWidgets>
 
 class LabeledLineEdit : public QWidget {
@@ -22,7 +25,41 @@ class DeletionList : public LabeledLineEdit {
 public:
     DeletionList(QWidget* parent = nullptr);
 
-    std::vector<uint64_t> deletionList() const;
+    //Sorted, unique ids of the line edit and the loaded id file. The number of dropped duplicates is written to duplicates if given.
+    std::vector<uint64_t> deletionList(size_t* duplicates = nullptr) const;
+
+private:
+    QPushButton* pbLoadFile;
+    QPushButton* pbClearFile;
+    std::vector<uint64_t> fileIds;
+
+private slots:
+    void loadIdFile();
+    void clearIdFile();
+};
+
+//Snapshot of the import widgets, taken on the GUI thread when an import starts.
+struct GltfImportSettings {
+    std::filesystem::path gltf_path;
+    std::filesystem::path patch_path;
+    bool import_textures = true;
+    bool use_max_lod_range = false;
+    bool use_custom_material_id = false;
+    int material_id = 0;
+    bool use_original_bone_info = false;
+    bool invert_normals_x = false;
+    bool invert_normals_y = false;
+    bool invert_normals_z = false;
+    bool auto_orient_normals = true;
+    bool recalculate_normals = false;
+    bool optimize_vertex_cache = false;
+    bool skip_unchanged = false;
+    bool weld_vertices = false;
+    WeldTolerances weld_tolerances;
+    bool generate_lods = false;
+    int lod_levels = 3;
+    std::vector<uint64_t> deletion_list;
+    size_t duplicate_deletion_ids = 0;
 };
 
 class GltfImportOptions : public QGroupBox {
@@ -39,6 +76,13 @@ public:
     bool doInvertNormalsY();
     bool doInvertNormalsZ();
     bool autoOrientNormals();
+    bool recalculateNormals();
+    bool optimizeVertexCache();
+    bool skipUnchangedResources();
+    bool weldVertices();
+    WeldTolerances weldTolerances();
+    bool generateLods();
+    int lodLevels();
     int materialId();
 
 private:
@@ -51,11 +95,31 @@ private:
     QCheckBox* cbInvertNormalY;
     QCheckBox* cbInvertNormalZ;
     QCheckBox* cbAutoOrientNormal;
+    QCheckBox* cbRecalculateNormals;
+    QCheckBox* cbOptimizeVertexCache;
+    QCheckBox* cbSkipUnchanged;
 
     QSpinBox* sbMaterialId;
 
+    QCheckBox* cbWeldVertices;
+    QDoubleSpinBox* sbWeldPosition;
+    QDoubleSpinBox* sbWeldNormal;
+    QDoubleSpinBox* sbWeldUV;
+    QDoubleSpinBox* sbWeldWeight;
+
+    QCheckBox* cbGenerateLods;
+    QSpinBox* sbLodLevels;
+
 private slots:
     void materialIdOverrideChecked(int);
+    void weldVerticesChecked(int);
+    void generateLodsChecked(int);
+};
+
+//Summary text of a scanned glTF file, error is set if the file couldn't be scanned.
+struct GltfInfoScan {
+    QString info;
+    QString error;
 };
 
 class GltfImportWidget : public QWidget {
@@ -64,22 +128,23 @@ class GltfImportWidget : public QWidget {
 public:
     GltfImportWidget(QWidget* parent = nullptr);
 
+    BackgroundJob* job() const;
+
 private:
+    BackgroundJob* importJob;
     PathBrowserWidget* gltfBrowser;
     QTextEdit* teGltfInfo;
+    QFutureWatcher<GltfInfoScan> infoScanner;
     GltfImportOptions* options;
     DeletionList* deletionList;
     PathBrowserWidget* patchFileBrowser;
     QPushButton* pbImport;
 
-    void doImport();
+    GltfImportSettings settings() const;
+    void doImport(const GltfImportSettings& settings);
 
 private slots:
     void gltfPathUpdated();
+    void gltfInfoScanned();
     void importGltf();
-
-signals:
-    void importStarted();
-    void importFinished();
-
 };
\ No newline at end of file
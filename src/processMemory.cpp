@@ -0,0 +1,90 @@
+#include "processMemory.h"
+
+#include <cstdio>
+#include <string>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#include <fstream>
+#endif
+
+namespace {
+    //Rounded to whole MiB, finer steps are noise for a process peak.
+    std::string toMiB(uint64_t bytes) {
+        return std::to_string((bytes + 512 * 1024) / (1024 * 1024)) + " MiB";
+    }
+}
+
+uint64_t currentResidentBytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.WorkingSetSize;
+#else
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0;
+    uint64_t resident = 0;
+    if (!(statm >> size >> resident))
+        return 0;
+    return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+uint64_t peakResidentBytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#if defined(__APPLE__)
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    //Linux reports KiB. ru_maxrss isn't affected by clear_refs, VmHWM is.
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        unsigned long long kib = 0;
+        if (sscanf(line.c_str(), "VmHWM: %llu kB", &kib) == 1)
+            return static_cast<uint64_t>(kib) * 1024;
+    }
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+bool resetPeakResidentBytes() {
+#if defined(__linux__)
+    //Linux 4.0+, resets VmHWM to the current RSS.
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+    clear_refs.flush();
+    return static_cast<bool>(clear_refs);
+#else
+    return false;
+#endif
+}
+
+PeakMemoryMeter::PeakMemoryMeter() {
+    peakReset = resetPeakResidentBytes();
+    startPeak = peakResidentBytes();
+    startResident = currentResidentBytes();
+}
+
+std::string PeakMemoryMeter::summary() const {
+    const auto peak = peakResidentBytes();
+    if (!peak)
+        return "Peak memory: unavailable";
+
+    if (peakReset || peak > startPeak)
+        return "Peak memory: " + toMiB(peak) + " (" + toMiB(startResident) + " at start)";
+    return "Peak memory: below the earlier process peak of " + toMiB(peak) + " (" + toMiB(startResident) + " at start)";
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+//Resident memory of the process in bytes, the working set on Windows. 0 where unavailable.
+uint64_t currentResidentBytes();
+uint64_t peakResidentBytes();
+
+//Resets the peak to the current resident size. Only supported on Linux, returns false if the peak keeps covering
+//the whole lifetime of the process.
+bool resetPeakResidentBytes();
+
+//Measures the peak resident memory of a job. The process peak gets reset on construction where supported. Otherwise
+//the peak of the job is only known if it exceeded the earlier process peak. Jobs running at the same time are included.
+class PeakMemoryMeter {
+public:
+    PeakMemoryMeter();
+
+    //One line summary for the console, e.g. "Peak memory: 1843 MiB (312 MiB at start)".
+    std::string summary() const;
+
+private:
+    bool peakReset = false;
+    uint64_t startPeak = 0;
+    uint64_t startResident = 0;
+};
@@ -0,0 +1,6 @@
+#include "resourceHashes.h"
+
+BaseResourceHashes& BaseResourceHashes::instance() {
+    static BaseResourceHashes inst;
+    return inst;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "contentHash.h"
+#include "GlacierFormats.h"
+
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+//Session wide cache of content hashes of the serialized resources the repository resolves ids to. The repository is
+//loaded once at startup, callers have to check that its version is still the one the game loads. Thread safe.
+class BaseResourceHashes {
+public:
+    static BaseResourceHashes& instance();
+
+    //Whether the serialized repository version of a resource is byte identical to data, false if the repository doesn't
+    //contain it. Hashes of the repository versions are cached, so a mismatch against a known hash costs no decode. The
+    //repository version is decoded at most once per call, either to hash it on first use or to confirm a hash match.
+    template<typename Resource>
+    bool matches(const GlacierFormats::RuntimeId& id, const void* data, size_t size) {
+        const uint64_t key = id;
+        const auto data_hash = hashContent(data, size);
+        bool cached = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (auto known = hashes.find(key); known != hashes.end()) {
+                if (known->second != data_hash)
+                    return false;
+                cached = true;
+            }
+        }
+
+        auto repo = GlacierFormats::ResourceRepository::instance();
+        if (!repo->contains(id))
+            return false;
+        auto resource = repo->getResource<Resource>(id);
+        if (!resource)
+            return false;
+        const auto base_data = resource->serializeToBuffer();
+        const auto base_size = base_data.size() * sizeof(base_data[0]);
+
+        if (!cached) {
+            const auto base_hash = hashContent(base_data.data(), base_size);
+            std::lock_guard<std::mutex> lock(mutex);
+            hashes.emplace(key, base_hash);
+        }
+        return base_size == size && memcmp(base_data.data(), data, size) == 0;
+    }
+
+private:
+    BaseResourceHashes() = default;
+
+    std::mutex mutex;
+    std::unordered_map<uint64_t, uint64_t> hashes;
+};
@@ -0,0 +1,29 @@
+#include "rigCache.h"
+
+#include <stdexcept>
+
+using namespace GlacierFormats;
+
+RigCache& RigCache::instance() {
+    static RigCache inst;
+    return inst;
+}
+
+std::shared_ptr<BoneMapping> RigCache::boneMapping(const RuntimeId& borg_id) {
+    const uint64_t key = borg_id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (auto cached = boneMappings.find(key); cached != boneMappings.end())
+            return cached->second;
+    }
+
+    //Converted outside of the lock, a rig requested by two threads at once just gets converted twice.
+    auto borg = ResourceRepository::instance()->getResource<BORG>(borg_id);
+    if (!borg)
+        throw std::runtime_error("Failed to load BORG " + static_cast<std::string>(borg_id));
+    auto mapping = std::make_shared<BoneMapping>(borg->getNameToBoneIndexMap());
+    borg.reset();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return boneMappings.try_emplace(key, std::move(mapping)).first->second;
+}
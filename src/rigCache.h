@@ -0,0 +1,25 @@
+#pragma once
+#include "GlacierFormats.h"
+
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+
+using BoneMapping = std::decay_t<decltype(std::declval<GlacierFormats::BORG&>().getNameToBoneIndexMap())>;
+
+//Bone name mappings of the rigs used by imports. Outfit sets share a single BORG, so every rig only gets decoded and
+//converted once per session, later imports of models using the same rig reuse the result. Thread safe.
+class RigCache {
+public:
+    static RigCache& instance();
+
+    //Bone name to BORG bone index mapping of the rig. Throws if the BORG can't be loaded.
+    std::shared_ptr<BoneMapping> boneMapping(const GlacierFormats::RuntimeId& borg_id);
+
+private:
+    RigCache() = default;
+
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, std::shared_ptr<BoneMapping>> boneMappings;
+};
@@ -0,0 +1,284 @@
+#include "rpkgMerge.h"
+#include "contentHash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <regex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+    constexpr char RPKG_MAGIC[4] = { 'G', 'K', 'P', 'R' };
+    constexpr char RPKG_V2_MAGIC[4] = { '2', 'K', 'P', 'R' };
+    constexpr uint32_t COMPRESSED_SIZE_MASK = 0x3FFFFFFF;
+    constexpr size_t HASH_ENTRY_SIZE = 8 + 8 + 4;
+    constexpr size_t RESOURCE_INFO_SIZE = 4 * 6;
+    constexpr size_t COPY_CHUNK_SIZE = 1 << 20;
+
+    template<typename T>
+    T read(std::istream& in) {
+        T value;
+        in.read(reinterpret_cast<char*>(&value), sizeof(value));
+        if (!in)
+            throw std::runtime_error("Unexpected end of RPKG archive");
+        return value;
+    }
+
+    template<typename T>
+    void write(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    struct MergedEntry {
+        const RpkgEntry* entry = nullptr;
+        size_t archive = 0;
+    };
+
+    struct WrittenBlob {
+        uint64_t offset;
+        uint64_t size;
+        size_t archive;
+        const RpkgEntry* entry;
+    };
+
+    void readChunk(std::ifstream& in, uint64_t offset, size_t size, std::vector<char>& buffer) {
+        buffer.resize(size);
+        in.seekg(offset);
+        in.read(buffer.data(), size);
+        if (!in)
+            throw std::runtime_error("RPKG resource data out of bounds");
+    }
+
+    //Copies a blob in chunks to the current position of out and returns its hash.
+    uint64_t copyBlob(std::ifstream& in, uint64_t offset, uint64_t size, std::ostream& out, std::vector<char>& buffer) {
+        auto hash = CONTENT_HASH_SEED;
+        for (uint64_t copied = 0; copied < size; copied += buffer.size()) {
+            readChunk(in, offset + copied, static_cast<size_t>(std::min<uint64_t>(COPY_CHUNK_SIZE, size - copied)), buffer);
+            hash = hashContent(buffer.data(), buffer.size(), hash);
+            out.write(buffer.data(), buffer.size());
+        }
+        return hash;
+    }
+
+    bool equalBlobs(std::ifstream& a, uint64_t a_offset, std::ifstream& b, uint64_t b_offset, uint64_t size, std::vector<char>& a_buffer, std::vector<char>& b_buffer) {
+        for (uint64_t compared = 0; compared < size; compared += a_buffer.size()) {
+            const auto chunk = static_cast<size_t>(std::min<uint64_t>(COPY_CHUNK_SIZE, size - compared));
+            readChunk(a, a_offset + compared, chunk, a_buffer);
+            readChunk(b, b_offset + compared, chunk, b_buffer);
+            if (a_buffer != b_buffer)
+                return false;
+        }
+        return true;
+    }
+}
+
+uint64_t RpkgEntry::storedSize() const {
+    const auto compressed_size = data_size & COMPRESSED_SIZE_MASK;
+    return compressed_size ? compressed_size : size_final;
+}
+
+bool parseArchiveFileName(const std::string& file_name, std::string& base, int& patch) {
+    static const std::regex archive_regex("((?:chunk|dlc)[0-9]+)(?:patch([0-9]+))?\\.rpkg", std::regex::icase);
+    std::smatch match;
+    if (!std::regex_match(file_name, match, archive_regex))
+        return false;
+    base = match.str(1);
+    patch = match[2].matched ? std::stoi(match.str(2)) : -1;
+    return true;
+}
+
+bool parsePatchFileName(const std::string& file_name, std::string& base, int& patch) {
+    return parseArchiveFileName(file_name, base, patch) && patch >= 0;
+}
+
+RpkgArchive readRpkgTables(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("Failed to open " + path.generic_string());
+
+    RpkgArchive archive;
+    archive.path = path;
+    std::string base;
+    int patch = 0;
+    archive.patch = parsePatchFileName(path.filename().generic_string(), base, patch);
+
+    char magic[4];
+    in.read(magic, sizeof(magic));
+    if (in && memcmp(magic, RPKG_V2_MAGIC, sizeof(magic)) == 0)
+        throw std::runtime_error(path.filename().generic_string() + ": RPKG v2 archives are not supported");
+    if (!in || memcmp(magic, RPKG_MAGIC, sizeof(magic)) != 0)
+        throw std::runtime_error(path.filename().generic_string() + " is not a RPKG archive");
+
+    const auto file_count = read<uint32_t>(in);
+    const auto hash_table_size = read<uint32_t>(in);
+    const auto resource_table_size = read<uint32_t>(in);
+    if (hash_table_size != file_count * HASH_ENTRY_SIZE)
+        throw std::runtime_error(path.filename().generic_string() + ": Invalid RPKG hash table size");
+
+    if (archive.patch) {
+        const auto deletion_count = read<uint32_t>(in);
+        archive.deletion_list.resize(deletion_count);
+        in.read(reinterpret_cast<char*>(archive.deletion_list.data()), deletion_count * sizeof(uint64_t));
+        if (!in)
+            throw std::runtime_error(path.filename().generic_string() + ": Unexpected end of deletion list");
+    }
+
+    archive.entries.resize(file_count);
+    for (auto& entry : archive.entries) {
+        entry.id = read<uint64_t>(in);
+        entry.offset = read<uint64_t>(in);
+        entry.data_size = read<uint32_t>(in);
+    }
+
+    size_t resource_table_read = 0;
+    for (auto& entry : archive.entries) {
+        in.read(entry.type.data(), entry.type.size());
+        const auto reference_table_size = read<uint32_t>(in);
+        entry.states_chunk_size = read<uint32_t>(in);
+        entry.size_final = read<uint32_t>(in);
+        entry.size_in_memory = read<uint32_t>(in);
+        entry.size_in_video_memory = read<uint32_t>(in);
+
+        resource_table_read += RESOURCE_INFO_SIZE + reference_table_size;
+        if (resource_table_read > resource_table_size)
+            throw std::runtime_error(path.filename().generic_string() + ": Invalid RPKG resource table");
+
+        entry.references.resize(reference_table_size);
+        in.read(entry.references.data(), reference_table_size);
+        if (!in)
+            throw std::runtime_error(path.filename().generic_string() + ": Unexpected end of resource table");
+    }
+
+    return archive;
+}
+
+RpkgMergeReport mergeRpkgArchives(const std::vector<std::filesystem::path>& archive_paths, const std::filesystem::path& output_path) {
+    RpkgMergeReport report;
+
+    std::vector<RpkgArchive> archives;
+    archives.reserve(archive_paths.size());
+    for (const auto& path : archive_paths)
+        archives.push_back(readRpkgTables(path));
+
+    //Resolve the final entry set, newest archive wins
+    std::unordered_map<uint64_t, MergedEntry> merged;
+    std::vector<uint64_t> order;
+    std::vector<uint64_t> deletion_list;
+    for (size_t a = 0; a < archives.size(); ++a) {
+        for (const auto id : archives[a].deletion_list) {
+            if (merged.erase(id))
+                ++report.overridden;
+            deletion_list.push_back(id);
+        }
+        for (const auto& entry : archives[a].entries) {
+            auto [it, inserted] = merged.insert_or_assign(entry.id, MergedEntry{ &entry, a });
+            if (inserted)
+                order.push_back(entry.id);
+            else
+                ++report.overridden;
+        }
+    }
+    order.erase(std::remove_if(order.begin(), order.end(), [&merged](uint64_t id) { return !merged.count(id); }), order.end());
+
+    std::sort(deletion_list.begin(), deletion_list.end());
+    deletion_list.erase(std::unique(deletion_list.begin(), deletion_list.end()), deletion_list.end());
+    report.deletions = deletion_list.size();
+    report.resources = order.size();
+
+    uint64_t resource_table_size = 0;
+    for (const auto id : order)
+        resource_table_size += RESOURCE_INFO_SIZE + merged[id].entry->references.size();
+    const uint64_t hash_table_size = order.size() * HASH_ENTRY_SIZE;
+    if (resource_table_size > UINT32_MAX || hash_table_size > UINT32_MAX)
+        throw std::runtime_error("Merged RPKG tables exceed the format limits");
+
+    const uint64_t header_size = sizeof(RPKG_MAGIC) + 3 * sizeof(uint32_t) + sizeof(uint32_t) + deletion_list.size() * sizeof(uint64_t);
+    const uint64_t data_offset = header_size + hash_table_size + resource_table_size;
+
+    std::ofstream out(output_path, std::ios::binary);
+    if (!out)
+        throw std::runtime_error("Failed to open " + output_path.generic_string() + " for writing");
+
+    //Stream blobs behind the space reserved for header and tables
+    std::vector<std::ifstream> inputs;
+    for (const auto& archive : archives) {
+        inputs.emplace_back(archive.path, std::ios::binary);
+        if (!inputs.back())
+            throw std::runtime_error("Failed to open " + archive.path.generic_string());
+    }
+
+    //Every blob is copied in chunks and hashed on the way. Duplicates get detected afterwards, the next blob then
+    //overwrites the copy and the file is truncated to the written data at the end.
+    std::vector<uint64_t> offsets(order.size());
+    std::unordered_multimap<uint64_t, WrittenBlob> written;
+    std::vector<char> buffer;
+    std::vector<char> candidate;
+    uint64_t offset = data_offset;
+    uint64_t file_size = data_offset;
+    for (size_t i = 0; i < order.size(); ++i) {
+        const auto& [entry, archive] = merged[order[i]];
+        const auto size = entry->storedSize();
+
+        out.seekp(offset);
+        const auto hash = copyBlob(inputs[archive], entry->offset, size, out, buffer);
+        file_size = std::max(file_size, offset + size);
+
+        //Identical blobs need the same size and scramble flag, content gets compared to rule out hash collisions.
+        bool duplicate = false;
+        auto [begin, end] = written.equal_range(hash);
+        for (auto it = begin; it != end && !duplicate; ++it) {
+            const auto& blob = it->second;
+            if (blob.size != size || blob.entry->data_size != entry->data_size)
+                continue;
+            if (equalBlobs(inputs[archive], entry->offset, inputs[blob.archive], blob.entry->offset, size, buffer, candidate)) {
+                offsets[i] = blob.offset;
+                duplicate = true;
+            }
+        }
+        if (duplicate) {
+            ++report.deduplicated;
+            continue;
+        }
+
+        offsets[i] = offset;
+        written.emplace(hash, WrittenBlob{ offset, size, archive, entry });
+        offset += size;
+    }
+
+    //Header and tables
+    out.seekp(0);
+    out.write(RPKG_MAGIC, sizeof(RPKG_MAGIC));
+    write(out, static_cast<uint32_t>(order.size()));
+    write(out, static_cast<uint32_t>(hash_table_size));
+    write(out, static_cast<uint32_t>(resource_table_size));
+    write(out, static_cast<uint32_t>(deletion_list.size()));
+    out.write(reinterpret_cast<const char*>(deletion_list.data()), deletion_list.size() * sizeof(uint64_t));
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        const auto& entry = *merged[order[i]].entry;
+        write(out, entry.id);
+        write(out, offsets[i]);
+        write(out, entry.data_size);
+    }
+
+    for (const auto id : order) {
+        const auto& entry = *merged[id].entry;
+        out.write(entry.type.data(), entry.type.size());
+        write(out, static_cast<uint32_t>(entry.references.size()));
+        write(out, entry.states_chunk_size);
+        write(out, entry.size_final);
+        write(out, entry.size_in_memory);
+        write(out, entry.size_in_video_memory);
+        out.write(entry.references.data(), entry.references.size());
+    }
+
+    out.close();
+    if (!out)
+        throw std::runtime_error("Failed to write " + output_path.generic_string());
+    if (file_size > offset)
+        std::filesystem::resize_file(output_path, offset);
+
+    report.bytes_written = offset;
+    return report;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+//Minimal reader for the tables of RPKG v1 archives. Resource data is never decompressed, entries only describe
+//where the stored, possibly compressed and scrambled, blob of each resource is located.
+struct RpkgEntry {
+    uint64_t id = 0;
+    uint64_t offset = 0;
+    //Compressed size in the lower 30 bits, 0 for uncompressed data. Bit 31 marks scrambled data.
+    uint32_t data_size = 0;
+
+    std::array<char, 4> type{};
+    uint32_t states_chunk_size = 0;
+    uint32_t size_final = 0;
+    uint32_t size_in_memory = 0;
+    uint32_t size_in_video_memory = 0;
+    //Raw reference table, copied as is.
+    std::vector<char> references;
+
+    //Size of the blob stored in the archive.
+    uint64_t storedSize() const;
+};
+
+struct RpkgArchive {
+    std::filesystem::path path;
+    bool patch = false;
+    std::vector<uint64_t> deletion_list;
+    std::vector<RpkgEntry> entries;
+};
+
+//Splits an archive name, <category>.rpkg or <category>patch<M>.rpkg with category chunk<N> or dlc<N>, into its
+//category and patch number M. patch is -1 for base archives. Returns false for other names.
+bool parseArchiveFileName(const std::string& file_name, std::string& base, int& patch);
+
+//Same for patch archives only. Patch archives carry a deletion list in their header.
+bool parsePatchFileName(const std::string& file_name, std::string& base, int& patch);
+
+//Reads header and tables of an archive. Throws on malformed or unsupported archives.
+RpkgArchive readRpkgTables(const std::filesystem::path& path);
+
+struct RpkgMergeReport {
+    size_t resources = 0;
+    //Resources replaced by a newer archive or removed by a newer deletion list.
+    size_t overridden = 0;
+    //Resources whose blob is identical to an already written one and got pointed at it.
+    size_t deduplicated = 0;
+    size_t deletions = 0;
+    uint64_t bytes_written = 0;
+};
+
+//Merges patch archives, ordered from oldest to newest, into a single patch archive. Blobs are streamed through in
+//chunks without decompression, so memory use doesn't depend on the resource sizes. Newer entries replace older ones, a newer deletion list removes older entries of the same id,
+//deletion lists are unioned and identical blobs are stored once.
+RpkgMergeReport mergeRpkgArchives(const std::vector<std::filesystem::path>& archives, const std::filesystem::path& output_path);
@@ -0,0 +1,78 @@
+#include "runtimeIdList.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    constexpr size_t RUNTIME_ID_DIGITS = 16;
+
+    //Value of a hex digit, -1 for all other characters.
+    int hexValue(char c) {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    bool isTextByte(unsigned char c) {
+        return (c >= 0x20 && c < 0x7F) || c == '\t' || c == '\n' || c == '\r';
+    }
+}
+
+std::vector<uint64_t> parseRuntimeIds(std::string_view text) {
+    std::vector<uint64_t> ids;
+    ids.reserve(text.size() / (RUNTIME_ID_DIGITS + 2));
+
+    uint64_t value = 0;
+    size_t digits = 0;
+    for (const char c : text) {
+        const int digit = hexValue(c);
+        if (digit < 0) {
+            value = 0;
+            digits = 0;
+            continue;
+        }
+
+        value = (value << 4) | static_cast<uint64_t>(digit);
+        if (++digits == RUNTIME_ID_DIGITS) {
+            ids.push_back(value);
+            value = 0;
+            digits = 0;
+        }
+    }
+    return ids;
+}
+
+std::vector<uint64_t> loadRuntimeIdFile(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in)
+        throw std::runtime_error("Failed to open " + path.generic_string());
+
+    std::string data(static_cast<size_t>(in.tellg()), '\0');
+    in.seekg(0);
+    in.read(data.data(), data.size());
+    if (!in)
+        throw std::runtime_error("Failed to read " + path.generic_string());
+
+    if (std::all_of(data.begin(), data.end(), [](char c) { return isTextByte(static_cast<unsigned char>(c)); }))
+        return parseRuntimeIds(data);
+
+    if (data.size() % sizeof(uint64_t))
+        throw std::runtime_error(path.filename().generic_string() + " is neither a text file nor a list of 64 bit ids");
+
+    std::vector<uint64_t> ids(data.size() / sizeof(uint64_t));
+    memcpy(ids.data(), data.data(), data.size());
+    return ids;
+}
+
+size_t sortUniqueRuntimeIds(std::vector<uint64_t>& ids) {
+    const auto count = ids.size();
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return count - ids.size();
+}
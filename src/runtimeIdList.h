@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+//Extracts runtime ids from free form text. Every run of hex digits yields one id per full 16 digits, shorter
+//remainders and all other characters are ignored. Runs in linear time.
+std::vector<uint64_t> parseRuntimeIds(std::string_view text);
+
+//Loads runtime ids from a text file, parsed like parseRuntimeIds, or from a binary file of little endian uint64 ids.
+//Files containing anything but printable ASCII are treated as binary. Throws on unreadable or malformed files.
+std::vector<uint64_t> loadRuntimeIdFile(const std::filesystem::path& path);
+
+//Sorts ids and removes duplicates. Returns the number of removed duplicates.
+size_t sortUniqueRuntimeIds(std::vector<uint64_t>& ids);
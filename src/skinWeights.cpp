@@ -0,0 +1,164 @@
+#include "skinWeights.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define SKIN_WEIGHTS_SSE2
+#endif
+
+namespace {
+    //Vertices per batch. Influences of a batch are stored slot major so every slot is a contiguous vector of weights.
+    constexpr int BATCH_SIZE = 8;
+
+    struct Batch {
+        alignas(16) float weights[MAX_BONE_INFLUENCES][BATCH_SIZE];
+        uint16_t joints[MAX_BONE_INFLUENCES][BATCH_SIZE];
+        alignas(16) int32_t quantized[MAX_BONE_INFLUENCES][BATCH_SIZE];
+    };
+
+    //Merges the influences of a vertex per bone and selects the largest ones into the batch slots, sorted by
+    //descending weight.
+    void selectInfluences(const float* joints, const float* weights, int influences, const std::vector<int>& bone_table,
+        uint16_t fallback_joint, Batch& batch, int lane, SkinWeightStats& stats) {
+        uint16_t vertex_joints[MAX_SKIN_INFLUENCES];
+        int vertex_bones[MAX_SKIN_INFLUENCES];
+        float vertex_weights[MAX_SKIN_INFLUENCES];
+        int count = 0;
+
+        for (int i = 0; i < influences; ++i) {
+            const auto weight = weights[i];
+            if (!(weight > 0.0f))
+                continue;
+
+            const auto joint = static_cast<size_t>(joints[i]);
+            const auto bone = joint < bone_table.size() ? bone_table[joint] : -1;
+            if (bone < 0) {
+                ++stats.unmapped;
+                continue;
+            }
+
+            int existing = 0;
+            while (existing < count && vertex_bones[existing] != bone)
+                ++existing;
+            if (existing < count) {
+                vertex_weights[existing] += weight;
+                ++stats.merged;
+                continue;
+            }
+
+            vertex_joints[count] = static_cast<uint16_t>(joint);
+            vertex_bones[count] = bone;
+            vertex_weights[count] = weight;
+            ++count;
+        }
+
+        if (count > MAX_BONE_INFLUENCES)
+            ++stats.truncated;
+
+        float sum = 0.0f;
+        for (int i = 0; i < count; ++i)
+            sum += vertex_weights[i];
+        if (count > 0 && std::abs(sum - 1.0f) > 0.5f / 255.0f)
+            ++stats.renormalized;
+
+        if (count == 0) {
+            vertex_joints[0] = fallback_joint;
+            vertex_weights[0] = 1.0f;
+            count = 1;
+            ++stats.unweighted;
+        }
+
+        //Selection sort of the largest influences, counts are tiny
+        for (int slot = 0; slot < MAX_BONE_INFLUENCES; ++slot) {
+            if (slot >= count) {
+                batch.joints[slot][lane] = 0;
+                batch.weights[slot][lane] = 0.0f;
+                continue;
+            }
+
+            int largest = slot;
+            for (int i = slot + 1; i < count; ++i) {
+                if (vertex_weights[i] > vertex_weights[largest])
+                    largest = i;
+            }
+            std::swap(vertex_weights[slot], vertex_weights[largest]);
+            std::swap(vertex_joints[slot], vertex_joints[largest]);
+
+            batch.joints[slot][lane] = vertex_joints[slot];
+            batch.weights[slot][lane] = vertex_weights[slot];
+        }
+    }
+
+    //Scales the weights of a batch to a sum of 255 and rounds them. The rounding error gets added to the largest
+    //weight, which is at least 255 / MAX_BONE_INFLUENCES and can absorb it.
+    void quantizeBatch(Batch& batch) {
+#ifdef SKIN_WEIGHTS_SSE2
+        for (int lane = 0; lane < BATCH_SIZE; lane += 4) {
+            __m128 sum = _mm_setzero_ps();
+            for (int slot = 0; slot < MAX_BONE_INFLUENCES; ++slot)
+                sum = _mm_add_ps(sum, _mm_load_ps(&batch.weights[slot][lane]));
+            const __m128 scale = _mm_div_ps(_mm_set1_ps(255.0f), sum);
+
+            __m128i total = _mm_setzero_si128();
+            for (int slot = 0; slot < MAX_BONE_INFLUENCES; ++slot) {
+                const __m128i quantized = _mm_cvtps_epi32(_mm_mul_ps(_mm_load_ps(&batch.weights[slot][lane]), scale));
+                _mm_store_si128(reinterpret_cast<__m128i*>(&batch.quantized[slot][lane]), quantized);
+                total = _mm_add_epi32(total, quantized);
+            }
+            const __m128i first = _mm_load_si128(reinterpret_cast<const __m128i*>(&batch.quantized[0][lane]));
+            const __m128i error = _mm_sub_epi32(_mm_set1_epi32(255), total);
+            _mm_store_si128(reinterpret_cast<__m128i*>(&batch.quantized[0][lane]), _mm_add_epi32(first, error));
+        }
+#else
+        for (int lane = 0; lane < BATCH_SIZE; ++lane) {
+            float sum = 0.0f;
+            for (int slot = 0; slot < MAX_BONE_INFLUENCES; ++slot)
+                sum += batch.weights[slot][lane];
+            const float scale = 255.0f / sum;
+
+            int32_t total = 0;
+            for (int slot = 0; slot < MAX_BONE_INFLUENCES; ++slot) {
+                batch.quantized[slot][lane] = static_cast<int32_t>(std::nearbyint(batch.weights[slot][lane] * scale));
+                total += batch.quantized[slot][lane];
+            }
+            batch.quantized[0][lane] += 255 - total;
+        }
+#endif
+    }
+}
+
+SkinWeightStats limitSkinWeights(const float* joints, const float* weights, size_t vertex_count, int influences,
+    const std::vector<int>& bone_table, uint16_t fallback_joint, std::vector<uint16_t>& out_joints, std::vector<float>& out_weights) {
+    SkinWeightStats stats;
+    out_joints.assign(vertex_count * SKIN_WEIGHT_SLOTS, 0);
+    out_weights.assign(vertex_count * SKIN_WEIGHT_SLOTS, 0.0f);
+
+    Batch batch;
+    for (size_t first = 0; first < vertex_count; first += BATCH_SIZE) {
+        const int lanes = static_cast<int>(std::min<size_t>(BATCH_SIZE, vertex_count - first));
+
+        for (int lane = 0; lane < lanes; ++lane) {
+            const auto vertex = first + lane;
+            selectInfluences(&joints[vertex * influences], &weights[vertex * influences], influences, bone_table, fallback_joint, batch, lane, stats);
+        }
+        //Unused lanes of the last batch get a dummy weight so they don't divide by zero.
+        for (int lane = lanes; lane < BATCH_SIZE; ++lane) {
+            for (int slot = 0; slot < MAX_BONE_INFLUENCES; ++slot)
+                batch.weights[slot][lane] = slot == 0 ? 1.0f : 0.0f;
+        }
+
+        quantizeBatch(batch);
+
+        for (int lane = 0; lane < lanes; ++lane) {
+            const auto vertex = first + lane;
+            for (int slot = 0; slot < MAX_BONE_INFLUENCES; ++slot) {
+                out_joints[vertex * SKIN_WEIGHT_SLOTS + slot] = batch.joints[slot][lane];
+                out_weights[vertex * SKIN_WEIGHT_SLOTS + slot] = static_cast<float>(batch.quantized[slot][lane]) / 255.0f;
+            }
+        }
+    }
+
+    return stats;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Number of bone influences per vertex supported by weighted PRIMs.
+constexpr int MAX_BONE_INFLUENCES = 6;
+//Influence slots per vertex of the output, two glTF JOINTS/WEIGHTS sets. The last two slots are always empty.
+constexpr int SKIN_WEIGHT_SLOTS = 8;
+//Maximum number of input influences per vertex.
+constexpr int MAX_SKIN_INFLUENCES = 64;
+
+struct SkinWeightStats {
+    //Vertices that had more than MAX_BONE_INFLUENCES influences.
+    size_t truncated = 0;
+    //Influences dropped because their joint isn't part of the rig.
+    size_t unmapped = 0;
+    //Influences merged into another influence of a joint mapped to the same bone.
+    size_t merged = 0;
+    //Vertices without any influence left, bound to the fallback joint.
+    size_t unweighted = 0;
+    //Vertices whose remaining weights were off a sum of 1 by more than half a quantization step.
+    size_t renormalized = 0;
+};
+
+//Limits skin weights to the MAX_BONE_INFLUENCES largest influences, normalizes them and quantizes them to 1/255 steps
+//with the quantized weights of each vertex summing up to exactly 255.
+//joints and weights hold influences values per vertex, at most MAX_SKIN_INFLUENCES. bone_table maps joint indices to rig bone indices, -1 marks
+//joints missing from the rig. Joints mapped to the same bone are merged. Vertices without any mapped influence get
+//bound to fallback_joint. Writes SKIN_WEIGHT_SLOTS joints and weights per vertex, sorted by descending weight.
+//Normalization and quantization run on batches of vertices with SSE2 where available.
+SkinWeightStats limitSkinWeights(const float* joints, const float* weights, size_t vertex_count, int influences,
+    const std::vector<int>& bone_table, uint16_t fallback_joint, std::vector<uint16_t>& out_joints, std::vector<float>& out_weights);
@@ -0,0 +1,207 @@
+#include "trace.h"
+#include "Console.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+namespace {
+    void writeJsonString(std::ostream& out, const char* text) {
+        out << '"';
+        for (; *text; ++text) {
+            const char c = *text;
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20)
+                out << ' ';
+            else
+                out << c;
+        }
+        out << '"';
+    }
+
+    std::string fixed(double value, int decimals) {
+        return QString::number(value, 'f', decimals).toStdString();
+    }
+
+    std::string padLeft(const std::string& text, size_t width) {
+        return text.size() < width ? std::string(width - text.size(), ' ') + text : text;
+    }
+
+    std::string padRight(const std::string& text, size_t width) {
+        return text.size() < width ? text + std::string(width - text.size(), ' ') : text;
+    }
+}
+
+Tracer& Tracer::instance() {
+    static Tracer inst;
+    return inst;
+}
+
+Tracer::Tracer() : epoch(std::chrono::steady_clock::now()) {
+
+}
+
+void Tracer::enable(const std::filesystem::path& output_directory) {
+    directory = output_directory;
+    isEnabled = true;
+}
+
+bool Tracer::enabled() const {
+    return isEnabled;
+}
+
+const std::filesystem::path& Tracer::outputDirectory() const {
+    return directory;
+}
+
+int64_t Tracer::now() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+uint32_t Tracer::threadId() {
+    static std::atomic<uint32_t> next_id = 1;
+    thread_local const uint32_t id = next_id++;
+    return id;
+}
+
+void Tracer::record(const TraceEvent& event) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (activeSessions)
+        recorded.push_back(event);
+}
+
+std::vector<TraceEvent> Tracer::events(int64_t start_us) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<TraceEvent> result;
+    std::copy_if(recorded.begin(), recorded.end(), std::back_inserter(result), [start_us](const TraceEvent& event) {
+        return event.start_us >= start_us;
+    });
+    return result;
+}
+
+void Tracer::sessionStarted() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++activeSessions;
+}
+
+void Tracer::sessionFinished() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--activeSessions == 0)
+        recorded.clear();
+}
+
+TraceSpan::TraceSpan(const char* name, const char* category) {
+    if (!Tracer::instance().enabled())
+        return;
+    event.name = name;
+    event.category = category;
+    event.start_us = Tracer::instance().now();
+    event.thread = Tracer::threadId();
+}
+
+TraceSpan::~TraceSpan() {
+    end();
+}
+
+void TraceSpan::end() {
+    if (!event.name)
+        return;
+    event.duration_us = Tracer::instance().now() - event.start_us;
+    Tracer::instance().record(event);
+    event.name = nullptr;
+}
+
+void TraceSpan::setBytes(uint64_t bytes) {
+    event.bytes = bytes;
+}
+
+TraceSession::TraceSession(const std::string& name) : name(name) {
+    auto& tracer = Tracer::instance();
+    if (!tracer.enabled())
+        return;
+    active = true;
+    start_us = tracer.now();
+    tracer.sessionStarted();
+}
+
+TraceSession::~TraceSession() {
+    if (!active)
+        return;
+
+    auto& tracer = Tracer::instance();
+    const auto events = tracer.events(start_us);
+    tracer.sessionFinished();
+
+    const auto path = tracer.outputDirectory() / (name + ".trace.json");
+    try {
+        writeChromeTrace(events, path);
+        printStatus(traceSummary(events) + "Trace written to " + path.generic_string());
+    }
+    catch (const std::exception& e) {
+        printError(e.what());
+    }
+}
+
+std::string traceSummary(const std::vector<TraceEvent>& events) {
+    struct Row {
+        size_t calls = 0;
+        int64_t total_us = 0;
+        int64_t max_us = 0;
+        uint64_t bytes = 0;
+        int64_t first_start = 0;
+    };
+
+    std::map<std::string, Row> rows;
+    for (const auto& event : events) {
+        auto [it, inserted] = rows.try_emplace(event.name);
+        auto& row = it->second;
+        if (inserted)
+            row.first_start = event.start_us;
+        ++row.calls;
+        row.total_us += event.duration_us;
+        row.max_us = std::max(row.max_us, event.duration_us);
+        row.bytes += event.bytes;
+    }
+
+    //Ordered by first occurrence, which follows the stage order of the job.
+    std::vector<std::pair<std::string, Row>> ordered(rows.begin(), rows.end());
+    std::sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) { return a.second.first_start < b.second.first_start; });
+
+    std::string summary = padRight("Span", 32) + padLeft("Calls", 7) + padLeft("Total ms", 12) + padLeft("Avg ms", 12) +
+        padLeft("Max ms", 12) + padLeft("MiB", 11) + padLeft("MiB/s", 11) + "\n";
+    for (const auto& [name, row] : ordered) {
+        const double total_ms = row.total_us / 1000.0;
+        const double mib = row.bytes / (1024.0 * 1024.0);
+        const double throughput = row.total_us ? mib / (row.total_us / 1e6) : 0.0;
+        summary += padRight(name.substr(0, 32), 32) + padLeft(std::to_string(row.calls), 7) + padLeft(fixed(total_ms, 2), 12) +
+            padLeft(fixed(total_ms / row.calls, 2), 12) + padLeft(fixed(row.max_us / 1000.0, 2), 12);
+        if (row.bytes)
+            summary += padLeft(fixed(mib, 2), 11) + padLeft(fixed(throughput, 1), 11) + "\n";
+        else
+            summary += padLeft("-", 11) + padLeft("-", 11) + "\n";
+    }
+    return summary;
+}
+
+void writeChromeTrace(const std::vector<TraceEvent>& events, const std::filesystem::path& path) {
+    std::ofstream out(path);
+    if (!out)
+        throw std::runtime_error("Failed to write trace file " + path.generic_string());
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (size_t i = 0; i < events.size(); ++i) {
+        const auto& event = events[i];
+        out << (i ? ",\n" : "\n") << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+            << ",\"ts\":" << event.start_us << ",\"dur\":" << event.duration_us << ",\"name\":";
+        writeJsonString(out, event.name);
+        out << ",\"cat\":";
+        writeJsonString(out, event.category);
+        if (event.bytes)
+            out << ",\"args\":{\"bytes\":" << event.bytes << "}";
+        out << "}";
+    }
+    out << "\n]}\n";
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TraceEvent {
+    //Names and categories are string literals, events only store the pointer.
+    const char* name = nullptr;
+    const char* category = nullptr;
+    int64_t start_us = 0;
+    int64_t duration_us = 0;
+    uint32_t thread = 0;
+    uint64_t bytes = 0;
+};
+
+//Collects timed spans while tracing is enabled. Recording takes a lock, spans are meant for stages and kernels,
+//not for per element work.
+class Tracer {
+public:
+    static Tracer& instance();
+
+    //Enables tracing, sessions write their trace into the directory.
+    void enable(const std::filesystem::path& output_directory);
+    bool enabled() const;
+    const std::filesystem::path& outputDirectory() const;
+
+    //Microseconds since the tracer was created.
+    int64_t now() const;
+    //Small, stable id of the calling thread.
+    static uint32_t threadId();
+
+    void record(const TraceEvent& event);
+    //Events that started at or after start_us. Events are dropped once no session is active anymore.
+    std::vector<TraceEvent> events(int64_t start_us) const;
+
+private:
+    Tracer();
+
+    friend class TraceSession;
+    void sessionStarted();
+    void sessionFinished();
+
+    bool isEnabled = false;
+    std::filesystem::path directory;
+    const std::chrono::steady_clock::time_point epoch;
+
+    mutable std::mutex mutex;
+    std::vector<TraceEvent> recorded;
+    int activeSessions = 0;
+};
+
+//Records the lifetime of the enclosing scope as a trace event. Does nothing if tracing is disabled.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, const char* category = "stage");
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    //Amount of data processed by the span, used for throughput in the summary.
+    void setBytes(uint64_t bytes);
+    //Ends the span before the end of the scope, for stages of flat code.
+    void end();
+
+private:
+    TraceEvent event;
+};
+
+//Groups the spans of one job. On destruction a summary table is printed to the console and the events are written
+//as Chrome trace JSON (chrome://tracing, ui.perfetto.dev) to <output directory>/<name>.trace.json.
+//Sessions that overlap in time contain each other's events.
+class TraceSession {
+public:
+    explicit TraceSession(const std::string& name);
+    ~TraceSession();
+
+    TraceSession(const TraceSession&) = delete;
+    TraceSession& operator=(const TraceSession&) = delete;
+
+private:
+    std::string name;
+    int64_t start_us = 0;
+    bool active = false;
+};
+
+//Aggregates events by name into a table of call count, total, average and max time and throughput.
+std::string traceSummary(const std::vector<TraceEvent>& events);
+
+void writeChromeTrace(const std::vector<TraceEvent>& events, const std::filesystem::path& path);